@@ -0,0 +1,462 @@
+#include "soxrpp.h"
+#include "soxrpp/cache.h"
+#include "soxrpp/fanout.h"
+#include "soxrpp/polyphase.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <numbers>
+#include <string>
+#include <vector>
+
+// Sweeps the wrapper's entry points over recipes, sample types, data shapes, channel counts, block sizes and rate pairs, and
+// prints one JSON document with throughput and per-call latency for every combination. Usage:
+//     soxrpp-bench [--quick] [--min-time <ms>] [--mode process|output|oneshot|oneshot-cached|auto|fanout] > results.json
+// The auto mode runs `AutoResampler` on float samples; compare it with process mode on the integer ratios to see the polyphase engine.
+// The fanout mode resamples one input to several rates with `FanoutResampler`, with and without `cascade`, and with one
+// `SoxResampler` per rate on the same input, reported as fanout, fanout-cascade and separate
+
+using soxrpp::SoxrDataShape;
+using soxrpp::SoxrQualityRecipe;
+using Clock = std::chrono::steady_clock;
+
+struct Recipe {
+    SoxrQualityRecipe recipe;
+    const char* name;
+};
+
+const std::vector<Recipe> all_recipes = {
+    {SoxrQualityRecipe::Quick, "Quick"},
+    {SoxrQualityRecipe::Low, "Low"},
+    {SoxrQualityRecipe::Medium, "Medium"},
+    {SoxrQualityRecipe::High, "High"},
+    {SoxrQualityRecipe::VeryHigh, "VeryHigh"},
+    {SoxrQualityRecipe::B16, "B16"},
+    {SoxrQualityRecipe::B20, "B20"},
+    {SoxrQualityRecipe::B24, "B24"},
+    {SoxrQualityRecipe::B28, "B28"},
+    {SoxrQualityRecipe::B32, "B32"},
+    {SoxrQualityRecipe::LSR0, "LSR0"},
+    {SoxrQualityRecipe::LSR1, "LSR1"},
+    {SoxrQualityRecipe::LSR2, "LSR2"},
+};
+const std::vector<std::pair<double, double>> all_rates = {
+    {44100, 48000},
+    {48000, 44100},
+    {96000, 48000},
+    {48000, 96000},
+    {48000, 16000},
+    {12000, 48000},
+    {96000, 16000},
+    {16000, 8000},
+    {8000, 16000},
+};
+const std::vector<size_t> all_blocks = {64, 256, 1024, 8192};
+const double fanout_irate = 48000;
+const std::vector<double> fanout_orates = {44100, 16000, 8000};
+
+struct Options {
+    bool quick = false;
+    double min_time_ms = 20;
+    std::string mode;
+};
+
+struct Config {
+    Recipe recipe;
+    double irate;
+    double orate;
+    size_t block;
+};
+
+struct Result {
+    size_t frames = 0;
+    double seconds = 0;
+    std::vector<double> latencies_ns;
+};
+
+template <typename Type>
+constexpr const char* type_name() {
+    if constexpr (std::is_same_v<Type, float>) {
+        return "float32";
+    } else if constexpr (std::is_same_v<Type, double>) {
+        return "float64";
+    } else if constexpr (std::is_same_v<Type, int32_t>) {
+        return "int32";
+    } else {
+        return "int16";
+    }
+}
+
+template <typename Type>
+Type from_unit(double x) {
+    if constexpr (std::is_floating_point_v<Type>) {
+        return static_cast<Type>(x);
+    } else {
+        return static_cast<Type>(x * std::numeric_limits<Type>::max());
+    }
+}
+
+// Owns samples for `Channels` channels in either layout and hands out SoxrBuffer views into them
+template <typename Type, SoxrDataShape Shape, size_t Channels>
+class Block {
+  private:
+    static constexpr bool interleaved = Shape == SoxrDataShape::Interleaved;
+    static constexpr size_t buffer_channels = interleaved ? 1 : Channels;
+    std::vector<std::vector<Type>> m_data;
+    size_t m_frames;
+
+  public:
+    Block(size_t frames, double frequency = 0)
+        : m_data(buffer_channels, std::vector<Type>(frames * (interleaved ? Channels : 1)))
+        , m_frames(frames) //
+    {
+        for (size_t i = 0; i < frames; i++) {
+            for (size_t c = 0; c < Channels; c++) {
+                Type x = from_unit<Type>(0.5 * std::sin(2 * std::numbers::pi * frequency * i + c));
+                if constexpr (interleaved) {
+                    m_data[0][i * Channels + c] = x;
+                } else {
+                    m_data[c][i] = x;
+                }
+            }
+        }
+    }
+
+    size_t frames() const {
+        return m_frames;
+    }
+
+    soxrpp::SoxrBuffer<Type, buffer_channels> buffer(size_t frames) {
+        std::array<Type*, buffer_channels> ptrs;
+        for (size_t c = 0; c < buffer_channels; c++) {
+            ptrs[c] = m_data[c].data();
+        }
+        return soxrpp::SoxrBuffer<Type, buffer_channels>(ptrs, interleaved ? frames * Channels : frames);
+    }
+};
+
+template <typename Type, SoxrDataShape Shape>
+using IoSpec = soxrpp::SoxrIoSpec<Type, Shape, Type, Shape>;
+
+template <typename Fn>
+Result measure(const Options& options, Fn&& step) {
+    Result result;
+    const auto budget = std::chrono::duration<double, std::milli>(options.min_time_ms);
+    const auto start = Clock::now();
+    auto now = start;
+    // Always take a few samples so short budgets still produce a latency distribution
+    while (now - start < budget || result.latencies_ns.size() < 8) {
+        auto before = Clock::now();
+        result.frames += step();
+        now = Clock::now();
+        result.latencies_ns.push_back(std::chrono::duration<double, std::nano>(now - before).count());
+    }
+    result.seconds = std::chrono::duration<double>(now - start).count();
+    return result;
+}
+
+template <typename Type, SoxrDataShape Shape, size_t Channels>
+Result bench_process(const Options& options, const Config& config) {
+    soxrpp::SoxResampler<Type, Type, Shape, Shape> resampler(
+        config.irate, config.orate, Channels, IoSpec<Type, Shape>(), soxrpp::SoxrQualitySpec(config.recipe.recipe, 0));
+    Block<Type, Shape, Channels> input(config.block, 1000 / config.irate);
+    Block<Type, Shape, Channels> output((size_t)(config.block * config.orate / config.irate) + 16);
+    auto ibuf = input.buffer(input.frames());
+    auto obuf = output.buffer(output.frames());
+    return measure(options, [&] {
+        return resampler.process(ibuf, obuf).first;
+    });
+}
+
+template <typename Type, SoxrDataShape Shape, size_t Channels>
+Result bench_auto(const Options& options, const Config& config) {
+    soxrpp::AutoResampler<Type, Type, Shape, Shape> resampler(
+        config.irate, config.orate, Channels, IoSpec<Type, Shape>(), soxrpp::SoxrQualitySpec(config.recipe.recipe, 0));
+    Block<Type, Shape, Channels> input(config.block, 1000 / config.irate);
+    Block<Type, Shape, Channels> output((size_t)(config.block * config.orate / config.irate) + 16);
+    auto ibuf = input.buffer(input.frames());
+    auto obuf = output.buffer(output.frames());
+    return measure(options, [&] {
+        return resampler.process(ibuf, obuf).first;
+    });
+}
+
+template <typename Type, SoxrDataShape Shape, size_t Channels>
+Result bench_output(const Options& options, const Config& config) {
+    soxrpp::SoxResampler<Type, Type, Shape, Shape> resampler(
+        config.irate, config.orate, Channels, IoSpec<Type, Shape>(), soxrpp::SoxrQualitySpec(config.recipe.recipe, 0));
+    Block<Type, Shape, Channels> input(config.block, 1000 / config.irate);
+    Block<Type, Shape, Channels> output((size_t)(config.block * config.orate / config.irate) + 1);
+    size_t consumed = 0;
+    resampler.set_input_fn(
+        [&](size_t len) {
+            len = std::min(len, input.frames());
+            consumed += len;
+            return input.buffer(len);
+        },
+        input.frames());
+    auto obuf = output.buffer(output.frames());
+    return measure(options, [&] {
+        consumed = 0;
+        resampler.output(obuf);
+        return consumed;
+    });
+}
+
+template <typename Type, SoxrDataShape Shape, size_t Channels>
+Result bench_oneshot(const Options& options, const Config& config) {
+    soxrpp::SoxrQualitySpec quality_spec(config.recipe.recipe, 0);
+    Block<Type, Shape, Channels> input(config.block, 1000 / config.irate);
+    Block<Type, Shape, Channels> output((size_t)(config.block * config.orate / config.irate) + 16);
+    auto ibuf = input.buffer(input.frames());
+    auto obuf = output.buffer(output.frames());
+    return measure(options, [&] {
+        return soxrpp::oneshot(config.irate, config.orate, Channels, ibuf, obuf, IoSpec<Type, Shape>(), quality_spec).first;
+    });
+}
+
+template <typename Type, SoxrDataShape Shape, size_t Channels>
+Result bench_oneshot_cached(const Options& options, const Config& config) {
+    soxrpp::ResamplerCache<Type, Type, Shape, Shape> cache(1);
+    soxrpp::SoxrQualitySpec quality_spec(config.recipe.recipe, 0);
+    Block<Type, Shape, Channels> input(config.block, 1000 / config.irate);
+    Block<Type, Shape, Channels> output((size_t)(config.block * config.orate / config.irate) + 16);
+    auto ibuf = input.buffer(input.frames());
+    auto obuf = output.buffer(output.frames());
+    return measure(options, [&] {
+        return soxrpp::oneshot(cache, config.irate, config.orate, Channels, ibuf, obuf, IoSpec<Type, Shape>(), quality_spec).first;
+    });
+}
+
+template <typename Type, size_t Channels>
+Result bench_fanout(const Options& options, const Config& config, const std::vector<double>& orates, bool cascade) {
+    soxrpp::FanoutResampler<Type, Type> resampler(
+        config.irate, orates, Channels, config.block, cascade, 1, soxrpp::SoxrQualitySpec(config.recipe.recipe, 0));
+    Block<Type, SoxrDataShape::Interleaved, Channels> input(config.block, 1000 / config.irate);
+    auto ibuf = input.buffer(input.frames());
+    return measure(options, [&] {
+        return resampler.process(ibuf);
+    });
+}
+
+template <typename Type, size_t Channels>
+Result bench_separate(const Options& options, const Config& config, const std::vector<double>& orates) {
+    using Resampler = soxrpp::SoxResampler<Type, Type, SoxrDataShape::Interleaved, SoxrDataShape::Interleaved>;
+    std::vector<Resampler> resamplers;
+    std::vector<Block<Type, SoxrDataShape::Interleaved, Channels>> outputs;
+    for (double orate : orates) {
+        resamplers.emplace_back(config.irate,
+                                orate,
+                                Channels,
+                                IoSpec<Type, SoxrDataShape::Interleaved>(),
+                                soxrpp::SoxrQualitySpec(config.recipe.recipe, 0));
+        outputs.emplace_back((size_t)(config.block * orate / config.irate) + 16);
+    }
+    Block<Type, SoxrDataShape::Interleaved, Channels> input(config.block, 1000 / config.irate);
+    auto ibuf = input.buffer(input.frames());
+    return measure(options, [&] {
+        size_t frames = 0;
+        for (size_t i = 0; i < resamplers.size(); i++) {
+            auto obuf = outputs[i].buffer(outputs[i].frames());
+            frames = resamplers[i].process(ibuf, obuf).first;
+        }
+        return frames;
+    });
+}
+
+double percentile(std::vector<double> values, double p) {
+    size_t i = std::min(values.size() - 1, (size_t)(p * values.size()));
+    std::nth_element(values.begin(), values.begin() + i, values.end());
+    return values[i];
+}
+
+void print_result(const char* mode,
+                  const char* type,
+                  const char* shape,
+                  size_t channels,
+                  const Config& config,
+                  const Result& result,
+                  bool& first,
+                  const std::vector<double>& orates = {}) {
+    // Fan-out results list every output rate instead of one
+    char rate[32];
+    std::string orate;
+    if (orates.empty()) {
+        snprintf(rate, sizeof(rate), "\"orate\": %g", config.orate);
+        orate = rate;
+    } else {
+        orate = "\"orates\": [";
+        for (size_t i = 0; i < orates.size(); i++) {
+            snprintf(rate, sizeof(rate), "%s%g", i == 0 ? "" : ", ", orates[i]);
+            orate += rate;
+        }
+        orate += "]";
+    }
+    double mean = 0;
+    double max = 0;
+    for (double latency : result.latencies_ns) {
+        mean += latency;
+        max = std::max(max, latency);
+    }
+    mean /= result.latencies_ns.size();
+    printf("%s\n    {\"mode\": \"%s\", \"recipe\": \"%s\", \"type\": \"%s\", \"shape\": \"%s\", \"channels\": %zu, \"block\": %zu, "
+           "\"irate\": %g, %s, \"calls\": %zu, \"frames\": %zu, \"seconds\": %.6f, \"frames_per_sec\": %.1f, "
+           "\"ns_per_frame\": %.3f, \"latency_ns\": {\"mean\": %.1f, \"p50\": %.1f, \"p99\": %.1f, \"max\": %.1f}}",
+           first ? "" : ",",
+           mode,
+           config.recipe.name,
+           type,
+           shape,
+           channels,
+           config.block,
+           config.irate,
+           orate.c_str(),
+           result.latencies_ns.size(),
+           result.frames,
+           result.seconds,
+           result.frames / result.seconds,
+           result.seconds * 1e9 / std::max<size_t>(result.frames, 1),
+           mean,
+           percentile(result.latencies_ns, .5),
+           percentile(result.latencies_ns, .99),
+           max);
+    first = false;
+}
+
+template <typename Type, SoxrDataShape Shape, size_t Channels>
+void run(const Options& options, const Config& config, bool& first) {
+    const char* shape = Shape == SoxrDataShape::Interleaved ? "interleaved" : "split";
+    const char* type = type_name<Type>();
+    try {
+        if (options.mode.empty() || options.mode == "process") {
+            print_result("process", type, shape, Channels, config, bench_process<Type, Shape, Channels>(options, config), first);
+        }
+        if (options.mode.empty() || options.mode == "output") {
+            print_result("output", type, shape, Channels, config, bench_output<Type, Shape, Channels>(options, config), first);
+        }
+        if (options.mode.empty() || options.mode == "oneshot") {
+            print_result("oneshot", type, shape, Channels, config, bench_oneshot<Type, Shape, Channels>(options, config), first);
+        }
+        if (options.mode.empty() || options.mode == "oneshot-cached") {
+            print_result(
+                "oneshot-cached", type, shape, Channels, config, bench_oneshot_cached<Type, Shape, Channels>(options, config), first);
+        }
+        if constexpr (std::is_same_v<Type, float>) {
+            if (options.mode.empty() || options.mode == "auto") {
+                print_result("auto", type, shape, Channels, config, bench_auto<Type, Shape, Channels>(options, config), first);
+            }
+        }
+    } catch (const soxrpp::SoxrError& err) {
+        fprintf(stderr, "skipping %s/%s/%s/%zu: %s\n", config.recipe.name, type, shape, Channels, err.what());
+    }
+}
+
+template <typename Type, SoxrDataShape Shape, size_t... Channels>
+void run_channels(const Options& options, const Config& config, bool& first) {
+    (run<Type, Shape, Channels>(options, config, first), ...);
+}
+
+template <typename Type, size_t... Channels>
+void run_shapes(const Options& options, const Config& config, bool& first) {
+    run_channels<Type, SoxrDataShape::Interleaved, Channels...>(options, config, first);
+    run_channels<Type, SoxrDataShape::Split, Channels...>(options, config, first);
+}
+
+template <typename Type, size_t Channels>
+void run_fanout(const Options& options, const Config& config, bool& first) {
+    const char* type = type_name<Type>();
+    try {
+        print_result("fanout",
+                     type,
+                     "interleaved",
+                     Channels,
+                     config,
+                     bench_fanout<Type, Channels>(options, config, fanout_orates, false),
+                     first,
+                     fanout_orates);
+        print_result("fanout-cascade",
+                     type,
+                     "interleaved",
+                     Channels,
+                     config,
+                     bench_fanout<Type, Channels>(options, config, fanout_orates, true),
+                     first,
+                     fanout_orates);
+        print_result("separate",
+                     type,
+                     "interleaved",
+                     Channels,
+                     config,
+                     bench_separate<Type, Channels>(options, config, fanout_orates),
+                     first,
+                     fanout_orates);
+    } catch (const soxrpp::SoxrError& err) {
+        fprintf(stderr, "skipping fanout %s/%s/%zu: %s\n", config.recipe.name, type, Channels, err.what());
+    }
+}
+
+template <typename Type, size_t... Channels>
+void run_fanout_channels(const Options& options, const Config& config, bool& first) {
+    (run_fanout<Type, Channels>(options, config, first), ...);
+}
+
+int main(int argc, char const* argv[]) {
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--quick") == 0) {
+            options.quick = true;
+        } else if (strcmp(argv[i], "--min-time") == 0 && i + 1 < argc) {
+            options.min_time_ms = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--mode") == 0 && i + 1 < argc) {
+            options.mode = argv[++i];
+        } else {
+            fprintf(stderr,
+                    "usage: %s [--quick] [--min-time <ms>] [--mode process|output|oneshot|oneshot-cached|auto|fanout]\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+
+    std::vector<Recipe> recipes = all_recipes;
+    std::vector<std::pair<double, double>> rates = all_rates;
+    std::vector<size_t> blocks = all_blocks;
+    if (options.quick) {
+        recipes = {all_recipes[1], all_recipes[3], all_recipes[4]};
+        rates = {all_rates[0], all_rates[3], all_rates[6]};
+        blocks = {1024};
+    }
+
+    soxrpp::SoxResampler<> probe(44100, 48000, 1);
+    printf("{\n  \"engine\": \"%s\",\n  \"results\": [", probe.engine());
+    bool first = true;
+    for (const Recipe& recipe : recipes) {
+        for (auto [irate, orate] : rates) {
+            for (size_t block : blocks) {
+                Config config{recipe, irate, orate, block};
+                run_shapes<float, 1, 2, 8, 32>(options, config, first);
+                run_shapes<double, 1, 2, 8, 32>(options, config, first);
+                run_shapes<int32_t, 1, 2, 8, 32>(options, config, first);
+                run_shapes<int16_t, 1, 2, 8, 32>(options, config, first);
+                fflush(stdout);
+            }
+        }
+    }
+    if (options.mode.empty() || options.mode == "fanout") {
+        for (const Recipe& recipe : recipes) {
+            for (size_t block : blocks) {
+                Config config{recipe, fanout_irate, fanout_orates[0], block};
+                run_fanout_channels<float, 1, 2, 8, 32>(options, config, first);
+                run_fanout_channels<int16_t, 1, 2, 8, 32>(options, config, first);
+                fflush(stdout);
+            }
+        }
+    }
+    printf("\n  ]\n}\n");
+
+    return 0;
+}
@@ -0,0 +1,74 @@
+#include "soxrpp.h"
+#include "soxrpp/quality.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Measures every quality configuration for a rate pair on this host and prints the quality/cost table, marking the Pareto front,
+// then the configuration picked for the given SNR target or CPU budget, if any. Usage:
+//     soxrpp-quality [--min-time <ms>] [--min-snr <dB>] [--budget <ns per frame>] <irate> <orate>
+
+int main(int argc, char const* argv[]) {
+    soxrpp::QualityAnalysisOptions options;
+    soxrpp::QualityRequirement requirement;
+    bool select = false;
+    std::vector<const char*> positional;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--min-time") == 0 && i + 1 < argc) {
+            options.min_time_ms = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--min-snr") == 0 && i + 1 < argc) {
+            requirement.min_snr_db = atof(argv[++i]);
+            select = true;
+        } else if (strcmp(argv[i], "--budget") == 0 && i + 1 < argc) {
+            requirement.max_ns_per_frame = atof(argv[++i]);
+            select = true;
+        } else {
+            positional.push_back(argv[i]);
+        }
+    }
+    if (positional.size() != 2) {
+        fprintf(stderr, "usage: %s [--min-time <ms>] [--min-snr <dB>] [--budget <ns per frame>] <irate> <orate>\n", argv[0]);
+        return 1;
+    }
+    const double irate = atof(positional[0]);
+    const double orate = atof(positional[1]);
+
+    std::vector<soxrpp::QualityMeasurement> table;
+    try {
+        table = soxrpp::analyze_quality(irate, orate, soxrpp::default_quality_candidates(), options);
+    } catch (const soxrpp::SoxrError& err) {
+        fprintf(stderr, "%s\n", err.what());
+        return 1;
+    }
+    std::vector<soxrpp::QualityMeasurement> front = soxrpp::pareto_front(table);
+
+    printf("%g -> %g\n", irate, orate);
+    printf("  %-26s %12s %10s %10s %12s\n", "quality", "ripple (dB)", "alias (dB)", "SNR (dB)", "ns/frame");
+    for (const soxrpp::QualityMeasurement& measurement : table) {
+        bool on_front = false;
+        for (const soxrpp::QualityMeasurement& point : front) {
+            on_front = on_front || point.name == measurement.name;
+        }
+        printf("%c %-26s %12.4f %10.1f %10.1f %12.2f\n",
+               on_front ? '*' : ' ',
+               measurement.name.c_str(),
+               measurement.passband_ripple_db,
+               measurement.aliasing_db,
+               measurement.snr_db,
+               measurement.ns_per_frame);
+    }
+
+    if (select) {
+        std::optional<soxrpp::QualityMeasurement> chosen = soxrpp::select_quality(table, requirement);
+        if (!chosen) {
+            printf("no configuration meets the requirement\n");
+            return 1;
+        }
+        printf("selected %s\n", chosen->name.c_str());
+    }
+    return 0;
+}
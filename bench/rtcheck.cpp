@@ -0,0 +1,286 @@
+#include "soxrpp.h"
+#include "soxrpp/adaptive.h"
+#include "soxrpp/realtime.h"
+#include "soxrpp/streaming.h"
+
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <vector>
+
+// Checks that the non-throwing API is safe on a real-time thread: after a warm-up, steady-state `try_process`, `try_output` and
+// `try_set_io_ratio` calls must not allocate, which a global allocation hook counts, and must not throw, which `noexcept` enforces.
+// `FixedBlockResampler::process` must not allocate from its first call after construction, nor run out of resampled frames, and
+// neither must `StreamingResampler::push` and `pull`, nor `AdaptiveResampler::push` and `pull`.
+// The hook replaces operator new and, on glibc, malloc itself, so it also sees soxr's allocations. Exits with status 1 if any
+// configuration allocated. Usage:
+//     soxrpp-rtcheck [--calls <n>]
+
+using soxrpp::SoxrDataShape;
+using soxrpp::SoxrQualityRecipe;
+
+namespace {
+
+std::atomic<bool> counting{false};
+std::atomic<size_t> allocations{0};
+
+void note_allocation() noexcept {
+    if (counting.load(std::memory_order_relaxed)) {
+        allocations.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void* allocate(size_t size) {
+#if !defined(__GLIBC__)
+    note_allocation();
+#endif
+    if (void* ptr = std::malloc(size == 0 ? 1 : size)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+struct Recipe {
+    SoxrQualityRecipe recipe;
+    const char* name;
+};
+
+const std::vector<Recipe> recipes = {
+    {SoxrQualityRecipe::Quick, "Quick"},
+    {SoxrQualityRecipe::Low, "Low"},
+    {SoxrQualityRecipe::High, "High"},
+    {SoxrQualityRecipe::VeryHigh, "VeryHigh"},
+    {SoxrQualityRecipe::B28, "B28"},
+};
+const std::vector<std::pair<double, double>> rates = {{44100, 48000}, {48000, 44100}, {48000, 16000}, {8000, 48000}};
+constexpr unsigned int num_channels = 2;
+constexpr size_t block = 256;
+constexpr size_t warmup_calls = 64;
+
+// Counts the allocations made by `calls` calls of `fn` after `warmup` uncounted ones, or returns -1 if a call failed
+template <typename Fn>
+long count_allocations(size_t calls, Fn&& fn, size_t warmup = warmup_calls) {
+    for (size_t i = 0; i < warmup; i++) {
+        if (!fn(i)) {
+            return -1;
+        }
+    }
+    allocations = 0;
+    counting = true;
+    bool ok = true;
+    for (size_t i = 0; i < calls && ok; i++) {
+        ok = fn(warmup + i);
+    }
+    counting = false;
+    return ok ? (long)allocations.load() : -1;
+}
+
+template <typename Type>
+long check_process(const Recipe& recipe, double irate, double orate, size_t calls) {
+    using IoSpec = soxrpp::SoxrIoSpec<const Type, SoxrDataShape::Interleaved, Type, SoxrDataShape::Interleaved>;
+    soxrpp::SoxResampler<const Type, Type> resampler(
+        irate, orate, num_channels, IoSpec(), soxrpp::SoxrQualitySpec(recipe.recipe, 0), soxrpp::SoxrRuntimeSpec(1));
+    static_assert(noexcept(resampler.try_process(std::declval<soxrpp::SoxrBuffer<const Type>&>(),
+                                                 std::declval<soxrpp::SoxrBuffer<Type>&>())));
+    std::vector<Type> input(block * num_channels);
+    std::vector<Type> output((soxrpp::output_frames(block, irate, orate) + 16) * num_channels);
+    soxrpp::SoxrBuffer<const Type> ibuf(input.data(), input.size());
+    soxrpp::SoxrBuffer<Type> obuf(output.data(), output.size());
+    return count_allocations(calls, [&](size_t) {
+        return resampler.try_process(ibuf, obuf).has_value();
+    });
+}
+
+long check_output(const Recipe& recipe, double irate, double orate, size_t calls) {
+    soxrpp::SoxResampler<const float, float> resampler(irate, orate, num_channels, {}, soxrpp::SoxrQualitySpec(recipe.recipe, 0));
+    std::vector<float> input(block * num_channels);
+    resampler.set_input_fn(
+        [&](size_t len) {
+            return soxrpp::SoxrBuffer<const float>(input.data(), std::min(len, block) * num_channels);
+        },
+        block);
+    std::vector<float> output(block * num_channels);
+    return count_allocations(calls, [&](size_t) {
+        return resampler.try_output(soxrpp::SoxrBuffer<float>(output.data(), output.size())).has_value();
+    });
+}
+
+long check_variable_rate(double irate, double orate, size_t calls) {
+    soxrpp::SoxrQualitySpec quality_spec(SoxrQualityRecipe::High, soxrpp::SoxrQualityFlags::VariableRate);
+    const double ratio = irate / orate;
+    // In variable-rate mode the ratio given to soxr_create is the largest one that can be set later
+    soxrpp::SoxResampler<const float, float> resampler(irate * 1.002, orate, num_channels, {}, quality_spec);
+    std::vector<float> input(block * num_channels);
+    std::vector<float> output(((size_t)(block / ratio * 1.1) + 16) * num_channels);
+    soxrpp::SoxrBuffer<const float> ibuf(input.data(), input.size());
+    soxrpp::SoxrBuffer<float> obuf(output.data(), output.size());
+    return count_allocations(calls, [&](size_t i) {
+        // Drifts the ratio by up to 0.1%, as a clock-drift controller would
+        const double target = ratio * (1 + 0.001 * ((i % 16) / 8.0 - 1));
+        return resampler.try_set_io_ratio(target, block).has_value() && resampler.try_process(ibuf, obuf).has_value();
+    });
+}
+
+long check_fixed_block(const Recipe& recipe, double irate, double orate, size_t calls) {
+    using Resampler = soxrpp::FixedBlockResampler<float, float>;
+    Resampler resampler(irate, orate, num_channels, block, Resampler::IoSpec(), soxrpp::SoxrQualitySpec(recipe.recipe, 0));
+    std::vector<float> input(resampler.max_input_frames() * num_channels);
+    std::vector<float> output(block * num_channels);
+    // No warm-up calls: the constructor warms the resampler up
+    return count_allocations(
+        calls,
+        [&](size_t) {
+            soxrpp::SoxrBuffer<float> ibuf(input.data(), resampler.input_frames() * num_channels);
+            return resampler.process(ibuf, soxrpp::SoxrBuffer<float>(output.data(), output.size())) == block;
+        },
+        0);
+}
+
+long check_streaming(const Recipe& recipe, double irate, double orate, size_t calls) {
+    const size_t oblock = soxrpp::output_frames(block, irate, orate);
+    soxrpp::StreamingResampler<float, float> resampler(irate,
+                                                       orate,
+                                                       num_channels,
+                                                       4 * block,
+                                                       4 * oblock,
+                                                       soxrpp::StreamingMode::Consumer,
+                                                       {},
+                                                       soxrpp::SoxrQualitySpec(recipe.recipe, 0));
+    std::vector<float> input(block * num_channels);
+    std::vector<float> output((oblock + 1) * num_channels);
+    size_t pulled = 0;
+    // No warm-up calls: the constructor warms the resampler up
+    return count_allocations(
+        calls,
+        [&](size_t i) {
+            resampler.push(soxrpp::SoxrBuffer<float>(input.data(), input.size()));
+            // Pulls at the output rate, so the rings neither fill up nor run dry
+            const size_t frames = (size_t)std::llround((double)(i + 1) * block * orate / irate) - pulled;
+            pulled += frames;
+            resampler.pull(soxrpp::SoxrBuffer<float>(output.data(), frames * num_channels));
+            return !resampler.failed();
+        },
+        0);
+}
+
+long check_adaptive(double irate, double orate, size_t calls) {
+    const size_t oblock = soxrpp::output_frames(block, irate, orate);
+    soxrpp::AdaptiveResampler<float, float> resampler(irate, orate, num_channels, 2.0 * oblock, 8 * block);
+    std::vector<float> input(block * num_channels);
+    std::vector<float> output((oblock + 1) * num_channels);
+    size_t pulled = 0;
+    // No warm-up calls: the constructor warms the resampler up
+    return count_allocations(
+        calls,
+        [&](size_t i) {
+            resampler.push(soxrpp::SoxrBuffer<float>(input.data(), input.size()));
+            const size_t frames = (size_t)std::llround((double)(i + 1) * block * orate / irate) - pulled;
+            pulled += frames;
+            resampler.pull(soxrpp::SoxrBuffer<float>(output.data(), frames * num_channels));
+            return !resampler.failed();
+        },
+        0);
+}
+
+void report(const char* mode, const char* recipe, double irate, double orate, long count, bool& clean) {
+    printf("%-14s %-9s %6g -> %-6g %s\n",
+           mode,
+           recipe,
+           irate,
+           orate,
+           count < 0 ? "error" : count == 0 ? "ok" : "ALLOCATES");
+    if (count != 0) {
+        clean = false;
+    }
+}
+
+} // namespace
+
+#if defined(__GLIBC__)
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+void __libc_free(void* ptr);
+
+void* malloc(size_t size) {
+    note_allocation();
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size) {
+    note_allocation();
+    return __libc_calloc(count, size);
+}
+
+void* realloc(void* ptr, size_t size) {
+    note_allocation();
+    return __libc_realloc(ptr, size);
+}
+
+void free(void* ptr) {
+    __libc_free(ptr);
+}
+}
+#endif
+
+void* operator new(size_t size) {
+    return allocate(size);
+}
+
+void* operator new[](size_t size) {
+    return allocate(size);
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept {
+    std::free(ptr);
+}
+
+int main(int argc, char const* argv[]) {
+    size_t calls = 1000;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--calls") == 0 && i + 1 < argc) {
+            calls = (size_t)atoll(argv[++i]);
+        } else {
+            fprintf(stderr, "usage: %s [--calls <n>]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    bool clean = true;
+    try {
+        for (const Recipe& recipe : recipes) {
+            for (auto [irate, orate] : rates) {
+                report("process-f32", recipe.name, irate, orate, check_process<float>(recipe, irate, orate, calls), clean);
+                report("process-i16", recipe.name, irate, orate, check_process<int16_t>(recipe, irate, orate, calls), clean);
+                report("output-f32", recipe.name, irate, orate, check_output(recipe, irate, orate, calls), clean);
+                report("fixed-block", recipe.name, irate, orate, check_fixed_block(recipe, irate, orate, calls), clean);
+                report("streaming", recipe.name, irate, orate, check_streaming(recipe, irate, orate, calls), clean);
+            }
+        }
+        for (auto [irate, orate] : rates) {
+            report("variable-rate", "High", irate, orate, check_variable_rate(irate, orate, calls), clean);
+            report("adaptive", "High", irate, orate, check_adaptive(irate, orate, calls), clean);
+        }
+    } catch (const soxrpp::SoxrError& err) {
+        fprintf(stderr, "%s\n", err.what());
+        return 1;
+    }
+
+    return clean ? 0 : 1;
+}
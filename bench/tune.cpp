@@ -0,0 +1,131 @@
+#include "soxrpp.h"
+#include "soxrpp/tuning.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+// Tunes soxr's runtime parameters on this host for one or more workloads and merges the results into the runtime profile that
+// SoxrRuntimeSpec::tuned() reads. Entries are tuned for one quality recipe, High unless given. Usage:
+//     soxrpp-tune [--profile <path>] [--min-time <ms>] [--quality <recipe>] <irate> <orate> <channels> <block> [...]
+
+using soxrpp::SoxrQualityRecipe;
+
+struct Recipe {
+    SoxrQualityRecipe recipe;
+    const char* name;
+};
+
+const std::vector<Recipe> recipes = {
+    {SoxrQualityRecipe::Quick, "Quick"},
+    {SoxrQualityRecipe::Low, "Low"},
+    {SoxrQualityRecipe::Medium, "Medium"},
+    {SoxrQualityRecipe::High, "High"},
+    {SoxrQualityRecipe::VeryHigh, "VeryHigh"},
+    {SoxrQualityRecipe::B16, "B16"},
+    {SoxrQualityRecipe::B20, "B20"},
+    {SoxrQualityRecipe::B24, "B24"},
+    {SoxrQualityRecipe::B28, "B28"},
+    {SoxrQualityRecipe::B32, "B32"},
+    {SoxrQualityRecipe::LSR0, "LSR0"},
+    {SoxrQualityRecipe::LSR1, "LSR1"},
+    {SoxrQualityRecipe::LSR2, "LSR2"},
+};
+
+struct Workload {
+    double irate;
+    double orate;
+    unsigned int channels;
+    size_t block;
+};
+
+int main(int argc, char const* argv[]) {
+    std::string path = soxrpp::RuntimeProfile::default_path();
+    soxrpp::RuntimeTuningOptions options;
+    const Recipe* quality = &recipes[3];
+    std::vector<const char*> positional;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--profile") == 0 && i + 1 < argc) {
+            path = argv[++i];
+        } else if (strcmp(argv[i], "--min-time") == 0 && i + 1 < argc) {
+            options.min_time_ms = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--quality") == 0 && i + 1 < argc) {
+            const char* name = argv[++i];
+            quality = nullptr;
+            for (const Recipe& recipe : recipes) {
+                if (strcmp(recipe.name, name) == 0) {
+                    quality = &recipe;
+                }
+            }
+            if (quality == nullptr) {
+                fprintf(stderr, "unknown quality recipe %s\n", name);
+                return 1;
+            }
+        } else {
+            positional.push_back(argv[i]);
+        }
+    }
+    if (positional.empty() || positional.size() % 4 != 0) {
+        fprintf(stderr,
+                "usage: %s [--profile <path>] [--min-time <ms>] [--quality <recipe>] <irate> <orate> <channels> <block> [<irate> "
+                "<orate> <channels> <block> ...]\n",
+                argv[0]);
+        return 1;
+    }
+    std::vector<Workload> workloads;
+    for (size_t i = 0; i < positional.size(); i += 4) {
+        workloads.push_back({atof(positional[i]),
+                             atof(positional[i + 1]),
+                             (unsigned int)atoi(positional[i + 2]),
+                             (size_t)atoll(positional[i + 3])});
+    }
+
+    soxrpp::RuntimeProfile profile = soxrpp::RuntimeProfile::load(path);
+    for (const Workload& workload : workloads) {
+        try {
+            soxrpp::RuntimeProfileEntry entry = soxrpp::tune_runtime_spec(workload.irate,
+                                                                          workload.orate,
+                                                                          workload.channels,
+                                                                          workload.block,
+                                                                          soxrpp::SoxrQualitySpec(quality->recipe, 0),
+                                                                          options);
+            const soxrpp::SoxrRuntimeSpec& spec = entry.runtime_spec;
+            printf("%s %g -> %g, %u channels, %zu frames, %s: log2_min_dft_size=%u log2_large_dft_size=%u coef_size_kbytes=%u "
+                   "num_threads=%u flags=%lu (%.2f ns/frame)\n",
+                   entry.host.c_str(),
+                   entry.input_rate,
+                   entry.output_rate,
+                   entry.num_channels,
+                   entry.block_frames,
+                   quality->name,
+                   spec.log2_min_dft_size,
+                   spec.log2_large_dft_size,
+                   spec.coef_size_kbytes,
+                   spec.num_threads,
+                   spec.flags,
+                   entry.ns_per_frame);
+            profile.insert(entry);
+        } catch (const soxrpp::SoxrError& err) {
+            fprintf(stderr, "skipping %g -> %g: %s\n", workload.irate, workload.orate, err.what());
+        }
+    }
+
+    try {
+        if (std::filesystem::path parent = std::filesystem::path(path).parent_path(); !parent.empty()) {
+            std::filesystem::create_directories(parent);
+        }
+        profile.save(path);
+    } catch (const soxrpp::SoxrError& err) {
+        fprintf(stderr, "couldn't write %s: %s\n", path.c_str(), err.what());
+        return 1;
+    } catch (const std::filesystem::filesystem_error& err) {
+        fprintf(stderr, "couldn't write %s: %s\n", path.c_str(), err.what());
+        return 1;
+    }
+    printf("wrote %s\n", path.c_str());
+
+    return 0;
+}
@@ -11,7 +11,7 @@ int main() {
     double irate = 1;
     double orate = 2;
 
-    size_t olen = (size_t)((in.size() / 2) * orate / irate + .5);
+    size_t olen = soxrpp::output_frames(in.size() / 2, irate, orate);
     std::vector<int32_t> outl(olen);
     std::vector<int32_t> outr(olen);
 
@@ -1,13 +1,21 @@
 #pragma once
 
+#include <algorithm>
 #include <any>
 #include <array>
+#include <chrono>
 #include <concepts>
+#include <iterator>
 #include <memory>
+#include <memory_resource>
 #include <optional>
+#include <ranges>
 #include <span>
 #include <string>
 #include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
 
 namespace soxrpp {
 
@@ -28,6 +36,81 @@ class SoxrError : std::exception {
     }
 };
 
+/**
+ * Result of a non-throwing call, after C++23's `std::expected`: either a value or the error soxr reported. soxr's errors are static
+ * strings, so neither outcome allocates, and the result can be checked on threads that mustn't throw. `value()` converts an error
+ * into a `SoxrError` for code that would rather throw.
+ */
+template <typename Type = void>
+class SoxrResult {
+  private:
+    [[no_unique_address]] std::conditional_t<std::is_void_v<Type>, std::monostate, Type> m_value{};
+    const char* m_error{nullptr};
+
+    struct Failure {};
+    constexpr SoxrResult(Failure, const char* error) noexcept
+        : m_error(error) {}
+
+  public:
+    constexpr SoxrResult() noexcept
+        requires std::is_void_v<Type>
+    = default;
+
+    template <typename Value = Type>
+        requires(!std::is_void_v<Type> && !std::is_same_v<std::remove_cvref_t<Value>, SoxrResult>)
+    constexpr SoxrResult(Value&& value) noexcept(std::is_nothrow_constructible_v<Type, Value&&>)
+        : m_value(std::forward<Value>(value)) {}
+
+    /**
+     * Creates a result holding soxr's error message, which must not be null.
+     */
+    static constexpr SoxrResult failure(const char* error) noexcept {
+        return SoxrResult(Failure{}, error);
+    }
+
+    constexpr bool has_value() const noexcept {
+        return m_error == nullptr;
+    }
+
+    constexpr explicit operator bool() const noexcept {
+        return has_value();
+    }
+
+    /**
+     * Access the value, which is only meaningful if `has_value()`.
+     */
+    template <typename Value = Type>
+        requires(!std::is_void_v<Type>)
+    constexpr const Value& operator*() const noexcept {
+        return m_value;
+    }
+
+    template <typename Value = Type>
+        requires(!std::is_void_v<Type>)
+    constexpr const Value* operator->() const noexcept {
+        return &m_value;
+    }
+
+    /**
+     * Access the value, throwing a `SoxrError` if there is an error instead.
+     */
+    constexpr decltype(auto) value() const {
+        if (m_error != nullptr) {
+            throw SoxrError(m_error);
+        }
+        if constexpr (!std::is_void_v<Type>) {
+            return (m_value);
+        }
+    }
+
+    /**
+     * Query the error message, or null if there is a value.
+     */
+    constexpr const char* error() const noexcept {
+        return m_error;
+    }
+};
+
 enum class SoxrDataShape { Interleaved, Split };
 
 namespace detail {
@@ -249,6 +332,23 @@ struct SoxrRuntimeSpec {
             .flags = this->flags,
         };
     }
+
+    /**
+     * Load the fastest known configuration for a workload on this host from the runtime profile written by `soxrpp-tune` (see
+     * `RuntimeProfile::default_path`). The profile is read once, on the first call. The entry for the same rates and quality spec
+     * with the closest channel count and block size is used; without one, this is the same as `SoxrRuntimeSpec(1)`. Defined in
+     * soxrpp/tuning.h, which must be included to call it.
+     * @param input_rate sample rate of the input
+     * @param output_rate target sample rate of the resampled output
+     * @param num_channels channel count
+     * @param block_frames typical number of input frames per `process` call
+     * @param quality_spec resampling quality configuration the workload uses
+     */
+    static SoxrRuntimeSpec tuned(double input_rate,
+                                 double output_rate,
+                                 unsigned int num_channels,
+                                 size_t block_frames,
+                                 const SoxrQualitySpec& quality_spec);
 };
 
 template <typename Type, size_t Channels = 1, size_t Extent = std::dynamic_extent>
@@ -308,12 +408,79 @@ class SoxrBuffer {
     size_t size(bool interleaved, unsigned int num_channels) const {
         return interleaved ? m_size / num_channels : m_size;
     }
+
+    /**
+     * Returns a view of the same memory that starts `frames` samples (per channel) later. Useful for continuing to write into a
+     * partially filled output buffer.
+     * @param frames number of samples per channel to skip, clamped to the size of the buffer
+     * @param interleaved whether the buffer is read as interleaved
+     * @param num_channels channel count
+     */
+    SoxrBuffer<Type, Channels> advance(size_t frames, bool interleaved, unsigned int num_channels) const {
+        size_t step = std::min(frames, size(interleaved, num_channels)) * (interleaved ? num_channels : 1);
+        std::array<Type*, Channels> ptrs;
+        for (size_t i = 0; i < Channels; i++) {
+            ptrs[i] = m_data[i] + step;
+        }
+        return SoxrBuffer<Type, Channels>(ptrs, m_size - step);
+    }
+
+    /**
+     * Returns a view of the first `frames` samples (per channel) of this buffer.
+     * @param frames number of samples per channel to keep, clamped to the size of the buffer
+     * @param interleaved whether the buffer is read as interleaved
+     * @param num_channels channel count
+     */
+    SoxrBuffer<Type, Channels> truncate(size_t frames, bool interleaved, unsigned int num_channels) const {
+        std::array<Type*, Channels> ptrs;
+        std::copy_n(m_data, Channels, ptrs.begin());
+        return SoxrBuffer<Type, Channels>(ptrs, std::min(frames, size(interleaved, num_channels)) * (interleaved ? num_channels : 1));
+    }
+
+    /**
+     * Query the pointer to channel `i` of a split buffer, or to the interleaved samples if `i` is 0.
+     */
+    Type* channel(size_t i) const noexcept {
+        return m_data[i];
+    }
+
+    /**
+     * Returns a view of `count` consecutive channels of a split buffer, starting at channel `first`. Channel pointers past `count` are
+     * null, so the view must be used with a channel count of at most `count`. Not meaningful for interleaved buffers.
+     * @param first index of the first channel in the view
+     * @param count number of channels in the view
+     */
+    SoxrBuffer<Type, Channels> channel_range(size_t first, size_t count) const {
+        std::array<Type*, Channels> ptrs{};
+        for (size_t i = 0; i < count && first + i < Channels; i++) {
+            ptrs[i] = m_data[first + i];
+        }
+        return SoxrBuffer<Type, Channels>(ptrs, m_size);
+    }
+};
+
+/**
+ * Default instrumentation policy for `SoxResampler`, which records nothing. A policy with `enabled` set to false is never called,
+ * so it adds no clock reads, branches or storage to the resampler. A policy with `enabled` set to true must provide these hooks,
+ * which are called on the thread that uses the resampler:
+ */
+struct NoInstrumentation {
+    static constexpr bool enabled = false;
+
+    // After each `process` call, with the frames read and written, the time spent, the total clip count and the current delay
+    void record_process(
+        size_t /*idone*/, size_t /*odone*/, std::chrono::nanoseconds /*elapsed*/, size_t /*clips*/, double /*delay*/) noexcept {}
+    // After each `output` call, like `record_process`; `elapsed` includes the time spent in the input provider
+    void record_output(size_t /*odone*/, std::chrono::nanoseconds /*elapsed*/, size_t /*clips*/, double /*delay*/) noexcept {}
+    // After each call to the input provider configured with `set_input_fn`, with the frames it returned
+    void record_input_fn(size_t /*ilen*/, std::chrono::nanoseconds /*elapsed*/) noexcept {}
 };
 
 template <typename InputType = float,
           typename OutputType = float,
           SoxrDataShape InputShape = SoxrDataShape::Interleaved,
-          SoxrDataShape OutputShape = SoxrDataShape::Interleaved>
+          SoxrDataShape OutputShape = SoxrDataShape::Interleaved,
+          typename Instrumentation = NoInstrumentation>
 class SoxResampler {
     // If OutputType is const, then process() will segfault when it tries to write
     static_assert(!std::is_const<OutputType>::value, "OutputType cannot be const");
@@ -321,13 +488,37 @@ class SoxResampler {
   private:
     soxr::soxr_t m_soxr{nullptr};
     unsigned int m_num_channels;
+    // From the runtime spec, for callers that schedule the resampler on their own threads
+    unsigned int m_num_threads;
+    [[no_unique_address]] Instrumentation m_instrumentation;
+
+    // Only stored when the policy is enabled, so the default policy takes no space
+    struct NoInstrumentationPtr {};
+    using InstrumentationPtr = std::conditional_t<Instrumentation::enabled, Instrumentation*, NoInstrumentationPtr>;
 
     struct InputFnContext {
         // Type-erased but memory-managed pointer to a copy of the input_fn lambda
         std::unique_ptr<void, void (*)(void*)> fn{nullptr, +[](void*) {}};
-        unsigned int num_channels;
+        unsigned int num_channels{0};
+        // Split buffers are passed to soxr as an array of channel pointers, which has to outlive the input_fn call
+        std::vector<void*> channel_ptrs;
+        // Kept so the input_fn can be re-registered when the context moves
+        soxr::soxr_input_fn_t trampoline{nullptr};
+        size_t max_ilen{0};
+        [[no_unique_address]] InstrumentationPtr instrumentation{};
     } m_input_fn_context;
 
+    // soxr holds a raw pointer to m_input_fn_context, so it has to be told whenever the context changes address. soxr_set_input_fn
+    // only stores the pointers and can't fail for a live soxr_t, which lets the moves be noexcept
+    void register_input_fn() noexcept {
+        if constexpr (Instrumentation::enabled) {
+            m_input_fn_context.instrumentation = &m_instrumentation;
+        }
+        if (m_soxr != nullptr && m_input_fn_context.trampoline != nullptr) {
+            soxr::soxr_set_input_fn(m_soxr, m_input_fn_context.trampoline, &m_input_fn_context, m_input_fn_context.max_ilen);
+        }
+    }
+
   public:
     /**
      * Creates a stream resampler.
@@ -337,6 +528,7 @@ class SoxResampler {
      * @param io_spec input/output configuration
      * @param quality_spec resampling quality configuration
      * @param runtime_spec runtime configuration
+     * @param instrumentation instrumentation policy, see `NoInstrumentation`
      */
     SoxResampler(double input_rate,
                  double output_rate,
@@ -344,8 +536,11 @@ class SoxResampler {
                  const SoxrIoSpec<InputType, InputShape, OutputType, OutputShape>& io_spec =
                      SoxrIoSpec<float, SoxrDataShape::Interleaved, float, SoxrDataShape::Interleaved>(),
                  const SoxrQualitySpec& quality_spec = SoxrQualitySpec(SoxrQualityRecipe::High, 0),
-                 const SoxrRuntimeSpec& runtime_spec = SoxrRuntimeSpec(1))
-        : m_num_channels(num_channels) //
+                 const SoxrRuntimeSpec& runtime_spec = SoxrRuntimeSpec(1),
+                 Instrumentation instrumentation = Instrumentation())
+        : m_num_channels(num_channels)
+        , m_num_threads(runtime_spec.num_threads)
+        , m_instrumentation(std::move(instrumentation)) //
     {
         soxr::soxr_error_t err;
         soxr::soxr_io_spec_t io_spec_raw = io_spec.c_struct();
@@ -357,8 +552,45 @@ class SoxResampler {
         }
     }
 
+    // Copying would double-free the underlying soxr_t
+    SoxResampler(const SoxResampler&) = delete;
+    SoxResampler& operator=(const SoxResampler&) = delete;
+
+    /**
+     * Takes over the resampler owned by `other`, including any configured input provider. `other` is left empty and may only be
+     * destroyed or assigned to.
+     */
+    SoxResampler(SoxResampler&& other) noexcept(std::is_nothrow_move_constructible_v<Instrumentation>)
+        : m_soxr(std::exchange(other.m_soxr, nullptr))
+        , m_num_channels(other.m_num_channels)
+        , m_num_threads(other.m_num_threads)
+        , m_instrumentation(std::move(other.m_instrumentation))
+        , m_input_fn_context(std::move(other.m_input_fn_context)) //
+    {
+        register_input_fn();
+    }
+
+    /**
+     * Deletes the currently owned resampler and takes over the one owned by `other`, including any configured input provider.
+     * `other` is left empty and may only be destroyed or assigned to.
+     */
+    SoxResampler& operator=(SoxResampler&& other) noexcept(std::is_nothrow_move_assignable_v<Instrumentation>) {
+        if (this != &other) {
+            soxr::soxr_delete(m_soxr);
+            m_soxr = std::exchange(other.m_soxr, nullptr);
+            m_num_channels = other.m_num_channels;
+            m_num_threads = other.m_num_threads;
+            m_instrumentation = std::move(other.m_instrumentation);
+            m_input_fn_context = std::move(other.m_input_fn_context);
+            register_input_fn();
+        }
+        return *this;
+    }
+
     ~SoxResampler() {
-        soxr::soxr_delete(m_soxr);
+        if (m_soxr != nullptr) {
+            soxr::soxr_delete(m_soxr);
+        }
     }
 
     /**
@@ -376,12 +608,35 @@ class SoxResampler {
     std::pair<size_t, size_t> process(const SoxrBuffer<InputType, InputChannels, InputExtent>& ibuf,
                                       SoxrBuffer<OutputType, OutputChannels, OutputExtent>& obuf,
                                       bool done = false) {
+        return try_process(ibuf, obuf, done).value();
+    }
+
+    /**
+     * Like `process`, but reports errors in the result instead of throwing, and never allocates, so it is safe to call on a
+     * real-time thread.
+     * @param ibuf readonly buffer to input samples
+     * @param obuf buffer to write output samples
+     * @param done true if there are no input samples and no more will be available
+     * @return The pair (`ilen`, `olen`) describing the number of samples read and written respectively, or soxr's error.
+     */
+    template <size_t InputChannels,
+              size_t OutputChannels,
+              size_t InputExtent = std::dynamic_extent,
+              size_t OutputExtent = std::dynamic_extent>
+    SoxrResult<std::pair<size_t, size_t>> try_process(const SoxrBuffer<InputType, InputChannels, InputExtent>& ibuf,
+                                                      SoxrBuffer<OutputType, OutputChannels, OutputExtent>& obuf,
+                                                      bool done = false) noexcept {
         // Asserts "interleaved ==> single channel array"
         constexpr bool input_interleaved = InputShape == SoxrDataShape::Interleaved;
         constexpr bool output_interleaved = OutputShape == SoxrDataShape::Interleaved;
         static_assert(!input_interleaved || InputChannels == 1, "Input buffer has invalid shape");
         static_assert(!output_interleaved || OutputChannels == 1, "Output buffer has invalid shape");
 
+        [[maybe_unused]] std::chrono::steady_clock::time_point start;
+        if constexpr (Instrumentation::enabled) {
+            start = std::chrono::steady_clock::now();
+        }
+
         size_t idone, odone;
         soxr::soxr_error_t err = soxr::soxr_process(m_soxr,
                                                     done ? nullptr : ibuf.data(input_interleaved),
@@ -391,7 +646,12 @@ class SoxResampler {
                                                     obuf.size(output_interleaved, m_num_channels),
                                                     &odone);
         if (err != 0) {
-            throw SoxrError(err);
+            return SoxrResult<std::pair<size_t, size_t>>::failure(err);
+        }
+
+        if constexpr (Instrumentation::enabled) {
+            m_instrumentation.record_process(
+                idone, odone, std::chrono::steady_clock::now() - start, *soxr::soxr_num_clips(m_soxr), soxr::soxr_delay(m_soxr));
         }
 
         return std::make_pair(idone, odone);
@@ -421,24 +681,104 @@ class SoxResampler {
                     delete (Func*)ptr;
                 })),
             .num_channels = m_num_channels,
-        };
-        soxr::soxr_set_input_fn(
-            m_soxr,
-            +[](void* context, soxrpp::soxr::soxr_cbuf_t* ibuf_internal, size_t len) {
+            .channel_ptrs = std::vector<void*>(Channels),
+            .trampoline = +[](void* context, soxrpp::soxr::soxr_cbuf_t* ibuf_internal, size_t len) {
                 InputFnContext* input_fn_context = static_cast<InputFnContext*>(context);
                 Func* func = static_cast<Func*>(input_fn_context->fn.get());
+                [[maybe_unused]] std::chrono::steady_clock::time_point start;
+                if constexpr (Instrumentation::enabled) {
+                    start = std::chrono::steady_clock::now();
+                }
                 SoxrBuffer<InputType, Channels, Extent> ibuf = (*func)(len);
                 constexpr bool interleaved = InputShape == SoxrDataShape::Interleaved;
                 size_t ilen = ibuf.size(interleaved, input_fn_context->num_channels);
+                if constexpr (Instrumentation::enabled) {
+                    input_fn_context->instrumentation->record_input_fn(ilen, std::chrono::steady_clock::now() - start);
+                }
                 if (ilen > 0) {
-                    *ibuf_internal = ibuf.data(interleaved);
+                    if constexpr (interleaved) {
+                        *ibuf_internal = ibuf.data(interleaved);
+                    } else {
+                        // ibuf is about to go out of scope, so copy its channel pointers somewhere that soxr can keep reading
+                        std::copy_n(static_cast<void**>(ibuf.data(interleaved)), Channels, input_fn_context->channel_ptrs.begin());
+                        *ibuf_internal = input_fn_context->channel_ptrs.data();
+                    }
                 }
                 return ilen;
             },
-            &m_input_fn_context,
+            .max_ilen = max_ilen,
+        };
+        register_input_fn();
+    }
+
+    /**
+     * Configure the input provider to read interleaved samples from a range, such as a container, a view or a decoder's frame queue.
+     * Contiguous ranges of `InputType` are handed to soxr in place, without copying. Other ranges are copied, and converted if
+     * needed, through a block of `max_ilen` frames that is allocated once. A trailing partial frame is ignored. Lvalue ranges are
+     * referenced and must outlive the resampler's use of them; rvalue ranges are moved into the provider. Use with the `output` API.
+     * @param range input range of interleaved samples convertible to `InputType`
+     * @param max_ilen the maximum number of input samples that will be requested
+     */
+    template <std::ranges::input_range Range>
+        requires std::ranges::viewable_range<Range> &&
+                 std::convertible_to<std::ranges::range_reference_t<Range>, std::remove_const_t<InputType>>
+    void set_input_range(Range&& range, size_t max_ilen) {
+        static_assert(InputShape == SoxrDataShape::Interleaved, "Input ranges must be interleaved");
+        using RawInputType = std::remove_const_t<InputType>;
+        using View = std::views::all_t<Range>;
+
+        struct State {
+            View view;
+            std::ranges::iterator_t<View> it;
+            std::ranges::sentinel_t<View> end;
+            std::vector<RawInputType> block;
+        };
+        // The iterators point into the view, so it must not move when the lambda does
+        auto state = std::make_unique<State>(std::views::all(std::forward<Range>(range)));
+        state->it = std::ranges::begin(state->view);
+        state->end = std::ranges::end(state->view);
+        const unsigned int num_channels = m_num_channels;
+
+        // A type rather than a variable so that the lambda can use it without capturing it
+        using ZeroCopy = std::bool_constant<
+            std::ranges::contiguous_range<View> &&
+            std::sized_sentinel_for<std::ranges::sentinel_t<View>, std::ranges::iterator_t<View>> &&
+            std::is_convertible_v<std::add_pointer_t<std::ranges::range_reference_t<View>>, InputType*>>;
+        if constexpr (!ZeroCopy::value) {
+            state->block.resize(max_ilen * num_channels);
+        }
+
+        set_input_fn(
+            [state = std::move(state), num_channels](size_t len) {
+                if constexpr (ZeroCopy::value) {
+                    size_t frames = std::min(len, (size_t)(state->end - state->it) / num_channels);
+                    InputType* ptr = std::to_address(state->it);
+                    state->it += frames * num_channels;
+                    return SoxrBuffer<InputType>(ptr, frames * num_channels);
+                } else {
+                    size_t count = 0;
+                    const size_t wanted = std::min(len, state->block.size() / num_channels) * num_channels;
+                    while (count < wanted && state->it != state->end) {
+                        state->block[count++] = static_cast<RawInputType>(*state->it);
+                        ++state->it;
+                    }
+                    return SoxrBuffer<InputType>(state->block.data(), count - count % num_channels);
+                }
+            },
             max_ilen);
     }
 
+    /**
+     * Configure the input provider to read interleaved samples from an iterator pair. See the range overload.
+     * @param first iterator to the first sample
+     * @param last sentinel marking the end of the samples
+     * @param max_ilen the maximum number of input samples that will be requested
+     */
+    template <std::input_iterator Iterator, std::sentinel_for<Iterator> Sentinel>
+    void set_input_range(Iterator first, Sentinel last, size_t max_ilen) {
+        set_input_range(std::ranges::subrange(std::move(first), std::move(last)), max_ilen);
+    }
+
     /**
      * Resample and output a block of data, using input samples from the configured input provider. Use either this API or the
      * `process` one, not both.
@@ -446,11 +786,33 @@ class SoxResampler {
      */
     template <size_t Channels = 1, size_t Extent = std::dynamic_extent>
     size_t output(SoxrBuffer<OutputType, Channels, Extent> obuf) {
+        return try_output(obuf).value();
+    }
+
+    /**
+     * Like `output`, but reports errors in the result instead of throwing. It doesn't allocate either, so it is safe to call on a
+     * real-time thread as long as the input provider is.
+     * @param obuf buffer to write output samples
+     * @return The number of samples written, or soxr's error.
+     */
+    template <size_t Channels = 1, size_t Extent = std::dynamic_extent>
+    SoxrResult<size_t> try_output(SoxrBuffer<OutputType, Channels, Extent> obuf) noexcept {
         constexpr bool interleaved = OutputShape == SoxrDataShape::Interleaved;
-        size_t odone = soxr::soxr_output(m_soxr, obuf.data(interleaved), obuf.size(interleaved, m_num_channels));
-        soxr::soxr_error_t err = soxr::soxr_error(m_soxr);
-        if (err != 0) {
-            throw SoxrError(err);
+        [[maybe_unused]] std::chrono::steady_clock::time_point start;
+        if constexpr (Instrumentation::enabled) {
+            start = std::chrono::steady_clock::now();
+        }
+        const size_t olen = obuf.size(interleaved, m_num_channels);
+        size_t odone = soxr::soxr_output(m_soxr, obuf.data(interleaved), olen);
+        // An error stops the output short, so a full buffer needs no check
+        if (odone < olen) {
+            if (soxr::soxr_error_t err = soxr::soxr_error(m_soxr); err != 0) {
+                return SoxrResult<size_t>::failure(err);
+            }
+        }
+        if constexpr (Instrumentation::enabled) {
+            m_instrumentation.record_output(
+                odone, std::chrono::steady_clock::now() - start, *soxr::soxr_num_clips(m_soxr), soxr::soxr_delay(m_soxr));
         }
         return odone;
     }
@@ -485,14 +847,40 @@ class SoxResampler {
         return soxr::soxr_engine(m_soxr);
     }
 
+    /**
+     * Query the channel count.
+     */
+    unsigned int num_channels() const noexcept {
+        return m_num_channels;
+    }
+
+    /**
+     * Query the number of threads soxr may use, as given in the runtime spec; 0 means as many as `OMP_NUM_THREADS` allows.
+     */
+    unsigned int num_threads() const noexcept {
+        return m_num_threads;
+    }
+
+    /**
+     * Access the instrumentation policy, for example to read the metrics it has collected.
+     */
+    Instrumentation& instrumentation() noexcept {
+        return m_instrumentation;
+    }
+
     /**
      * Prepare to process a fresh signal with the same config.
      */
     void clear() {
+        try_clear().value();
+    }
+
+    /**
+     * Like `clear`, but reports errors in the result instead of throwing.
+     */
+    SoxrResult<> try_clear() noexcept {
         soxr::soxr_error_t err = soxr::soxr_clear(m_soxr);
-        if (err != 0) {
-            throw SoxrError(err);
-        }
+        return err == 0 ? SoxrResult<>() : SoxrResult<>::failure(err);
     }
 
     /**
@@ -501,10 +889,18 @@ class SoxResampler {
      * @param slew_len transition smoothly from the current ratio to the target ratio over `slew_len` samples
      */
     void set_io_ratio(double io_ratio, size_t slew_len) {
+        try_set_io_ratio(io_ratio, slew_len).value();
+    }
+
+    /**
+     * Like `set_io_ratio`, but reports errors in the result instead of throwing, and never allocates, so it is safe to call on a
+     * real-time thread.
+     * @param io_ratio target resampling ratio
+     * @param slew_len transition smoothly from the current ratio to the target ratio over `slew_len` samples
+     */
+    SoxrResult<> try_set_io_ratio(double io_ratio, size_t slew_len) noexcept {
         soxr::soxr_error_t err = soxr::soxr_set_io_ratio(m_soxr, io_ratio, slew_len);
-        if (err != 0) {
-            throw SoxrError(err);
-        }
+        return err == 0 ? SoxrResult<>() : SoxrResult<>::failure(err);
     }
 
     /**
@@ -521,6 +917,19 @@ class SoxResampler {
     }
 };
 
+/**
+ * Compute the exact number of frames a stream produces in total, counting the flush after `done`. This is the output length of
+ * `oneshot`, and the sum of `odone` over all `process` calls for a stream with a fixed ratio that ends with `done`. It doesn't depend
+ * on the quality spec because soxr compensates for the filter delay, so the first output frame always lines up with the first input
+ * frame. Uses the same rounding as soxr.
+ * @param input_frames total number of input frames
+ * @param input_rate sample rate of the input
+ * @param output_rate target sample rate of the resampled output
+ */
+constexpr size_t output_frames(size_t input_frames, double input_rate, double output_rate) noexcept {
+    return (size_t)((double)input_frames / (input_rate / output_rate) + .5);
+}
+
 /**
  * Resample a (probably short) signal held entirely in memory. Note that the default quality is lower than for `process`.
  * @param input_rate sample rate of the input
@@ -578,6 +987,123 @@ inline std::pair<size_t, size_t> oneshot(double input_rate,
     return std::make_pair(idone, odone);
 }
 
+namespace detail {
+
+// Resamples into `output`, which is resized to exactly fit the result. Split output is stored one channel after another.
+template <typename Vector, typename InputType, size_t InputChannels, size_t InputExtent, typename OutputType, SoxrDataShape InputShape,
+          SoxrDataShape OutputShape>
+void oneshot_into(Vector& output,
+                  double input_rate,
+                  double output_rate,
+                  unsigned int num_channels,
+                  const SoxrBuffer<InputType, InputChannels, InputExtent>& ibuf,
+                  const SoxrIoSpec<InputType, InputShape, OutputType, OutputShape>& io_spec,
+                  const SoxrQualitySpec& quality_spec,
+                  const SoxrRuntimeSpec& runtime_spec) {
+    constexpr bool input_interleaved = InputShape == SoxrDataShape::Interleaved;
+    constexpr bool output_interleaved = OutputShape == SoxrDataShape::Interleaved;
+    static_assert(!input_interleaved || InputChannels == 1, "Input buffer has invalid shape");
+
+    const size_t ilen = ibuf.size(input_interleaved, num_channels);
+    const size_t olen = output_frames(ilen, input_rate, output_rate);
+    output.resize(olen * num_channels);
+    std::vector<void*> channels;
+    if constexpr (!output_interleaved) {
+        for (size_t c = 0; c < num_channels; c++) {
+            channels.push_back(output.data() + c * olen);
+        }
+    }
+
+    size_t idone, odone;
+    soxr::soxr_io_spec_t io_spec_raw = io_spec.c_struct();
+    soxr::soxr_quality_spec_t quality_spec_raw = quality_spec.c_struct();
+    soxr::soxr_runtime_spec_t runtime_spec_raw = runtime_spec.c_struct();
+    soxr::soxr_error_t err = soxr::soxr_oneshot(input_rate,
+                                                output_rate,
+                                                num_channels,
+                                                ibuf.data(input_interleaved),
+                                                ilen,
+                                                &idone,
+                                                output_interleaved ? (void*)output.data() : (void*)channels.data(),
+                                                olen,
+                                                &odone,
+                                                &io_spec_raw,
+                                                &quality_spec_raw,
+                                                &runtime_spec_raw);
+    if (err != 0) {
+        throw soxrpp::SoxrError(err);
+    }
+
+    // Only shrinks if soxr disagrees with output_frames, e.g. for rates where the ratio isn't exactly representable
+    if (odone < olen) {
+        if constexpr (!output_interleaved) {
+            for (size_t c = 1; c < num_channels; c++) {
+                std::copy_n(output.data() + c * olen, odone, output.data() + c * odone);
+            }
+        }
+        output.resize(odone * num_channels);
+    }
+}
+
+} // namespace detail
+
+/**
+ * Resample a (probably short) signal held entirely in memory into a newly allocated vector of exactly `output_frames` frames. Split
+ * output is stored one channel after another, so channel `c` starts at `c * size() / num_channels`. Note that the default quality is
+ * lower than for `process`.
+ * @param input_rate sample rate of the input
+ * @param output_rate target sample rate of the resampled output
+ * @param num_channels channel count
+ * @param ibuf buffer containing input samples
+ * @param io_spec input/output configuration
+ * @param quality_spec resampling quality configuration
+ * @param runtime_spec runtime configuration
+ * @return The resampled samples.
+ */
+template <typename InputType = float,
+          typename OutputType = float,
+          size_t InputChannels = 1,
+          size_t InputExtent = std::dynamic_extent,
+          SoxrDataShape InputShape = SoxrDataShape::Interleaved,
+          SoxrDataShape OutputShape = SoxrDataShape::Interleaved>
+inline std::vector<OutputType> oneshot(double input_rate,
+                                       double output_rate,
+                                       unsigned int num_channels,
+                                       const SoxrBuffer<InputType, InputChannels, InputExtent>& ibuf,
+                                       const SoxrIoSpec<InputType, InputShape, OutputType, OutputShape>& io_spec =
+                                           SoxrIoSpec<float, SoxrDataShape::Interleaved, float, SoxrDataShape::Interleaved>(),
+                                       const SoxrQualitySpec& quality_spec = SoxrQualitySpec(SoxrQualityRecipe::Low, 0),
+                                       const SoxrRuntimeSpec& runtime_spec = SoxrRuntimeSpec(1)) {
+    std::vector<OutputType> output;
+    detail::oneshot_into(output, input_rate, output_rate, num_channels, ibuf, io_spec, quality_spec, runtime_spec);
+    return output;
+}
+
+/**
+ * Like the `std::vector` overload, but allocates the output from `resource`, for example a `std::pmr::monotonic_buffer_resource`
+ * that is reset between batches.
+ * @param resource memory resource to allocate the output from
+ */
+template <typename InputType = float,
+          typename OutputType = float,
+          size_t InputChannels = 1,
+          size_t InputExtent = std::dynamic_extent,
+          SoxrDataShape InputShape = SoxrDataShape::Interleaved,
+          SoxrDataShape OutputShape = SoxrDataShape::Interleaved>
+inline std::pmr::vector<OutputType> oneshot(std::pmr::memory_resource* resource,
+                                            double input_rate,
+                                            double output_rate,
+                                            unsigned int num_channels,
+                                            const SoxrBuffer<InputType, InputChannels, InputExtent>& ibuf,
+                                            const SoxrIoSpec<InputType, InputShape, OutputType, OutputShape>& io_spec =
+                                                SoxrIoSpec<float, SoxrDataShape::Interleaved, float, SoxrDataShape::Interleaved>(),
+                                            const SoxrQualitySpec& quality_spec = SoxrQualitySpec(SoxrQualityRecipe::Low, 0),
+                                            const SoxrRuntimeSpec& runtime_spec = SoxrRuntimeSpec(1)) {
+    std::pmr::vector<OutputType> output(resource);
+    detail::oneshot_into(output, input_rate, output_rate, num_channels, ibuf, io_spec, quality_spec, runtime_spec);
+    return output;
+}
+
 } // namespace soxrpp
 
 #undef soxr_datatype_size
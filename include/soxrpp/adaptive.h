@@ -0,0 +1,297 @@
+#pragma once
+
+#include "soxrpp.h"
+#include "soxrpp/streaming.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <numbers>
+#include <type_traits>
+#include <vector>
+
+namespace soxrpp {
+
+/**
+ * Proportional-integral loop that estimates the relative drift between two clocks from the fill level of the FIFO between them. The
+ * loop is tuned as a second-order system with the bandwidth as its natural frequency and a damping ratio of 1/sqrt(2), which is
+ * slightly underdamped and trades a little overshoot for a faster lock; its integral term converges to the drift.
+ */
+class DriftController {
+  private:
+    double m_target;
+    double m_kp;
+    double m_ki;
+    double m_max_correction;
+    double m_integral{0};
+    double m_correction{0};
+
+  public:
+    /**
+     * Creates a controller.
+     * @param target FIFO fill level to hold, in frames
+     * @param rate rate at which the FIFO is drained, in frames per second
+     * @param bandwidth loop bandwidth in Hz; lower rejects more jitter in the fill level, higher locks faster
+     * @param max_correction largest relative rate correction ever applied, for example 0.001 for 1000 ppm
+     */
+    DriftController(double target, double rate, double bandwidth = 0.05, double max_correction = 0.002) noexcept
+        : m_target(target)
+        , m_max_correction(max_correction) //
+    {
+        // The fill level integrates rate * (drift - correction), so a PI loop gives a second-order system with these gains
+        const double omega = 2 * std::numbers::pi * bandwidth;
+        const double damping = std::numbers::sqrt2 / 2;
+        m_kp = 2 * damping * omega / rate;
+        m_ki = omega * omega / rate;
+    }
+
+    /**
+     * Feed one measurement of the fill level.
+     * @param fill current FIFO fill level, in frames
+     * @param dt time since the previous measurement, in seconds
+     * @return The relative rate correction to apply, where positive means draining faster.
+     */
+    double update(double fill, double dt) noexcept {
+        const double error = fill - m_target;
+        m_integral = std::clamp(m_integral + m_ki * error * dt, -m_max_correction, m_max_correction);
+        m_correction = std::clamp(m_kp * error + m_integral, -m_max_correction, m_max_correction);
+        return m_correction;
+    }
+
+    /**
+     * Query the estimated relative drift, in parts per million. Positive means the filling clock is faster than nominal.
+     */
+    double drift_ppm() const noexcept {
+        return m_integral * 1e6;
+    }
+
+    /**
+     * Query the most recent correction.
+     */
+    double correction() const noexcept {
+        return m_correction;
+    }
+
+    /**
+     * Forget the drift estimate.
+     */
+    void reset() noexcept {
+        m_integral = 0;
+        m_correction = 0;
+    }
+};
+
+/**
+ * Bridges two unsynchronized clocks, such as a capture device and a playback device with nominally equal rates. The producer pushes
+ * frames on its own clock and the consumer pulls them on another. On every pull, a `DriftController` compares the latency between
+ * the two (frames queued plus the resampler's delay) with a target and adjusts the resampling ratio with `set_io_ratio`, so the
+ * latency stays pinned to the target instead of slowly draining or filling the FIFO. `push` and `pull` never lock and may be called
+ * from different threads; interleaved data only.
+ */
+template <typename InputType = float, typename OutputType = float>
+class AdaptiveResampler {
+  private:
+    using RawInputType = std::remove_const_t<InputType>;
+    using Resampler = SoxResampler<const RawInputType, OutputType>;
+    using IoSpec = SoxrIoSpec<const RawInputType, SoxrDataShape::Interleaved, OutputType, SoxrDataShape::Interleaved>;
+
+    double m_nominal_ratio;
+    double m_output_rate;
+    double m_target_latency;
+    unsigned int m_num_channels;
+    Resampler m_resampler;
+    SpscRing<RawInputType> m_input;
+    DriftController m_controller;
+    // Output is held silent until the FIFO first reaches the target latency
+    bool m_started{false};
+    std::atomic<double> m_latency{0};
+    std::atomic<double> m_drift_ppm{0};
+    std::atomic<size_t> m_underruns{0};
+    std::atomic<size_t> m_overruns{0};
+    std::atomic<bool> m_failed{false};
+
+    static SoxrQualitySpec variable_rate(SoxrQualitySpec quality_spec) noexcept {
+        quality_spec.flags |= SoxrQualityFlags::VariableRate;
+        return quality_spec;
+    }
+
+    // Runs the resampler over silence at both ends of the correction range and then at the nominal ratio, so that soxr sets up its
+    // state and grows its buffers here rather than in the first `pull`. The output is drained every time, so nothing but the
+    // filter's own delay is left inside
+    void warm_up(double input_rate, double output_rate, size_t input_capacity, double max_correction) {
+        if (input_capacity == 0) {
+            m_resampler.set_io_ratio(m_nominal_ratio, 0);
+            return;
+        }
+        std::vector<RawInputType> silence(input_capacity * m_num_channels);
+        std::vector<OutputType> scratch(
+            (output_frames(input_capacity, input_rate * (1 - max_correction), output_rate) + 16) * m_num_channels);
+        auto ibuf = SoxrBuffer<const RawInputType>(silence.data(), silence.size());
+        auto obuf = SoxrBuffer<OutputType>(scratch.data(), scratch.size());
+        for (double correction : {-max_correction, max_correction, 0.0}) {
+            m_resampler.set_io_ratio(m_nominal_ratio * (1 + correction), 0);
+            size_t first_output = 0;
+            for (size_t k = 1; k < 65536; k++) {
+                if (m_resampler.process(ibuf, obuf).second > 0 && first_output == 0) {
+                    first_output = k;
+                }
+                if (first_output > 0 && k >= 16 && k >= 4 * first_output) {
+                    break;
+                }
+            }
+        }
+    }
+
+    // Frames between the producer and the consumer, in output frames
+    double measure_latency() noexcept {
+        return m_input.readable() / m_nominal_ratio + m_resampler.delay();
+    }
+
+  public:
+    /**
+     * Creates an adaptive resampler and warms it up over silence, so that the first `pull` finds soxr ready.
+     * @param input_rate nominal sample rate of the producer
+     * @param output_rate nominal sample rate of the consumer
+     * @param num_channels channel count
+     * @param target_latency latency to hold between producer and consumer, in output frames
+     * @param input_capacity number of input frames the FIFO can hold; should be well above the target latency
+     * @param bandwidth loop bandwidth in Hz, see `DriftController`
+     * @param max_correction largest relative rate correction, see `DriftController`
+     * @param quality_spec resampling quality configuration; variable-rate resampling is always enabled
+     * @param runtime_spec runtime configuration
+     */
+    AdaptiveResampler(double input_rate,
+                      double output_rate,
+                      unsigned int num_channels,
+                      double target_latency,
+                      size_t input_capacity,
+                      double bandwidth = 0.05,
+                      double max_correction = 0.002,
+                      const SoxrQualitySpec& quality_spec = SoxrQualitySpec(SoxrQualityRecipe::High, 0),
+                      const SoxrRuntimeSpec& runtime_spec = SoxrRuntimeSpec(1))
+        : m_nominal_ratio(input_rate / output_rate)
+        , m_output_rate(output_rate)
+        , m_target_latency(target_latency)
+        , m_num_channels(num_channels)
+        // In variable-rate mode the ratio given to soxr_create is the largest one that can be set later
+        , m_resampler(
+              input_rate * (1 + max_correction), output_rate, num_channels, IoSpec(), variable_rate(quality_spec), runtime_spec)
+        , m_input(input_capacity, num_channels)
+        , m_controller(target_latency, output_rate, bandwidth, max_correction) //
+    {
+        // soxr sets its state up again lazily after a clear, so warm up after it too; each warm-up ends at the nominal ratio
+        warm_up(input_rate, output_rate, input_capacity, max_correction);
+        m_resampler.clear();
+        warm_up(input_rate, output_rate, input_capacity, max_correction);
+    }
+
+    /**
+     * Queue input frames. Producer thread only. Frames that don't fit are dropped and counted as an overrun.
+     * @param ibuf buffer of interleaved input frames
+     * @return The number of frames accepted.
+     */
+    template <size_t Extent = std::dynamic_extent>
+    size_t push(const SoxrBuffer<InputType, 1, Extent>& ibuf) noexcept {
+        const size_t frames = ibuf.size(true, m_num_channels);
+        size_t pushed = 0;
+        while (pushed < frames) {
+            auto region = m_input.write_region();
+            size_t n = std::min(frames - pushed, region.size() / m_num_channels);
+            if (n == 0) {
+                break;
+            }
+            std::copy_n(ibuf.channel(0) + pushed * m_num_channels, n * m_num_channels, region.data());
+            m_input.commit_write(n);
+            pushed += n;
+        }
+        if (pushed < frames) {
+            m_overruns.fetch_add(1, std::memory_order_relaxed);
+        }
+        return pushed;
+    }
+
+    /**
+     * Fill `obuf` with resampled frames and update the rate correction. Consumer thread only, called once per period of the
+     * consumer's clock. Output is silent until the latency first reaches the target; after that, any shortfall is filled with zeros
+     * and counted as an underrun. Never throws; see `failed`.
+     * @param obuf buffer to write interleaved output frames
+     * @return The number of resampled frames written, before any zero padding.
+     */
+    template <size_t Extent = std::dynamic_extent>
+    size_t pull(const SoxrBuffer<OutputType, 1, Extent>& obuf) noexcept {
+        const size_t frames = obuf.size(true, m_num_channels);
+        size_t pulled = 0;
+        if (!m_started && measure_latency() >= m_target_latency) {
+            m_started = true;
+        }
+        while (m_started && pulled < frames && !m_failed.load(std::memory_order_relaxed)) {
+            auto region = m_input.read_region();
+            auto ibuf = SoxrBuffer<const RawInputType>(region.data(), region.size());
+            auto rest = SoxrBuffer<OutputType>(obuf.channel(0) + pulled * m_num_channels, (frames - pulled) * m_num_channels);
+            auto result = m_resampler.try_process(ibuf, rest);
+            if (!result) {
+                m_failed = true;
+                break;
+            }
+            auto [idone, odone] = *result;
+            m_input.commit_read(idone);
+            pulled += odone;
+            if (idone == 0 && odone == 0) {
+                break;
+            }
+        }
+        std::fill_n(obuf.channel(0) + pulled * m_num_channels, (frames - pulled) * m_num_channels, OutputType{});
+        if (m_started && pulled < frames) {
+            m_underruns.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        const double latency = measure_latency();
+        if (m_started && !m_failed.load(std::memory_order_relaxed)) {
+            const double correction = m_controller.update(latency, frames / m_output_rate);
+            if (!m_resampler.try_set_io_ratio(m_nominal_ratio * (1 + correction), frames)) {
+                m_failed = true;
+            }
+        }
+        m_latency.store(latency, std::memory_order_relaxed);
+        m_drift_ppm.store(m_controller.drift_ppm(), std::memory_order_relaxed);
+        return pulled;
+    }
+
+    /**
+     * Query the estimated drift of the producer's clock relative to the consumer's, in parts per million. Safe from any thread.
+     */
+    double drift_ppm() const noexcept {
+        return m_drift_ppm.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Query the latency between producer and consumer as of the last `pull`, in output frames. Safe from any thread.
+     */
+    double latency() const noexcept {
+        return m_latency.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Query the number of `pull` calls that could not be completely filled after the start.
+     */
+    size_t underruns() const noexcept {
+        return m_underruns.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Query the number of `push` calls that had to drop frames.
+     */
+    size_t overruns() const noexcept {
+        return m_overruns.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Query whether resampling stopped because the resampler reported an error. Nothing more is resampled after that, so every
+     * `pull` underruns.
+     */
+    bool failed() const noexcept {
+        return m_failed.load();
+    }
+};
+
+} // namespace soxrpp
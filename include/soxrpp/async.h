@@ -0,0 +1,178 @@
+#pragma once
+
+#include "soxrpp.h"
+
+#include <concepts>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace soxrpp {
+
+/**
+ * Anything that can run a task later, on some thread of its choosing: either an object with an `execute(task)` member, as in a
+ * minimal executor, or a callable `void(*)(task)`, as in a callback that posts to a scheduler. The task is a copyable
+ * `std::function<void()>` and must be run exactly once.
+ */
+template <typename Type>
+concept Executor = requires(Type& executor, std::function<void()> task) { executor.execute(std::move(task)); } ||
+                   std::invocable<Type&, std::function<void()>>;
+
+/**
+ * Executor that runs every task immediately on the calling thread.
+ */
+struct InlineExecutor {
+    void execute(std::function<void()> task) const {
+        task();
+    }
+};
+
+namespace detail {
+
+template <Executor ExecutorType>
+void submit(ExecutorType& executor, std::function<void()> task) {
+    if constexpr (requires { executor.execute(std::move(task)); }) {
+        executor.execute(std::move(task));
+    } else {
+        executor(std::move(task));
+    }
+}
+
+// Runs `fn` on `executor` and hands its result, or what it threw, to the returned future
+template <Executor ExecutorType, typename Fn, typename Result = std::invoke_result_t<Fn&>>
+std::future<Result> submit_for_result(ExecutorType& executor, Fn fn) {
+    // std::function needs a copyable task, so the promise is shared
+    auto promise = std::make_shared<std::promise<Result>>();
+    std::future<Result> future = promise->get_future();
+    submit(executor, [promise, fn = std::move(fn)]() mutable {
+        try {
+            promise->set_value(fn());
+        } catch (...) {
+            promise->set_exception(std::current_exception());
+        }
+    });
+    return future;
+}
+
+// soxr's OpenMP threads would compete with the executor's, so tasks always resample on the thread they run on
+inline SoxrRuntimeSpec single_threaded(SoxrRuntimeSpec runtime_spec) noexcept {
+    runtime_spec.num_threads = 1;
+    return runtime_spec;
+}
+
+} // namespace detail
+
+/**
+ * Run `resampler.process(ibuf, obuf, done)` as a task on `executor`. The resampler and both buffers must stay valid until the future
+ * is ready, and only one call per resampler may be in flight at a time. All the work has to stay on the executor's threads, so the
+ * resampler must have been created with `num_threads` set to 1 in its runtime spec, which is the default; otherwise this throws a
+ * `SoxrError` instead of letting soxr's OpenMP threads oversubscribe the executor.
+ * @param executor where to run the call, see `Executor`
+ * @param resampler resampler to run
+ * @param ibuf readonly buffer to input samples
+ * @param obuf buffer to write output samples
+ * @param done true if there are no input samples and no more will be available
+ * @return A future for the pair (`ilen`, `olen`), which rethrows any `SoxrError` from `get()`.
+ */
+template <Executor ExecutorType,
+          typename InputType,
+          typename OutputType,
+          SoxrDataShape InputShape,
+          SoxrDataShape OutputShape,
+          typename Instrumentation,
+          size_t InputChannels,
+          size_t OutputChannels,
+          size_t InputExtent,
+          size_t OutputExtent>
+std::future<std::pair<size_t, size_t>> process_async(
+    ExecutorType& executor,
+    SoxResampler<InputType, OutputType, InputShape, OutputShape, Instrumentation>& resampler,
+    const SoxrBuffer<InputType, InputChannels, InputExtent>& ibuf,
+    const SoxrBuffer<OutputType, OutputChannels, OutputExtent>& obuf,
+    bool done = false) {
+    if (resampler.num_threads() != 1) {
+        throw SoxrError("process_async needs a resampler created with num_threads set to 1");
+    }
+    return detail::submit_for_result(executor, [&resampler, ibuf, obuf = obuf, done]() mutable {
+        return resampler.process(ibuf, obuf, done);
+    });
+}
+
+/**
+ * Run `oneshot` as a task on `executor`. Both buffers must stay valid until the future is ready. soxr's own threads are disabled,
+ * whatever `runtime_spec` says, so the resampling only ever uses the thread the executor runs the task on.
+ * @param executor where to run the call, see `Executor`
+ * @param input_rate sample rate of the input
+ * @param output_rate target sample rate of the resampled output
+ * @param num_channels channel count
+ * @param ibuf buffer containing input samples
+ * @param obuf buffer to write output samples
+ * @param io_spec input/output configuration
+ * @param quality_spec resampling quality configuration
+ * @param runtime_spec runtime configuration
+ * @return A future for the pair (`ilen`, `olen`), which rethrows any `SoxrError` from `get()`.
+ */
+template <Executor ExecutorType,
+          size_t InputChannels,
+          size_t OutputChannels,
+          typename InputType = float,
+          typename OutputType = float,
+          size_t InputExtent = std::dynamic_extent,
+          size_t OutputExtent = std::dynamic_extent,
+          SoxrDataShape InputShape = SoxrDataShape::Interleaved,
+          SoxrDataShape OutputShape = SoxrDataShape::Interleaved>
+std::future<std::pair<size_t, size_t>> oneshot_async(
+    ExecutorType& executor,
+    double input_rate,
+    double output_rate,
+    unsigned int num_channels,
+    const SoxrBuffer<InputType, InputChannels, InputExtent>& ibuf,
+    const SoxrBuffer<OutputType, OutputChannels, OutputExtent>& obuf,
+    const SoxrIoSpec<InputType, InputShape, OutputType, OutputShape>& io_spec =
+        SoxrIoSpec<float, SoxrDataShape::Interleaved, float, SoxrDataShape::Interleaved>(),
+    const SoxrQualitySpec& quality_spec = SoxrQualitySpec(SoxrQualityRecipe::Low, 0),
+    const SoxrRuntimeSpec& runtime_spec = SoxrRuntimeSpec(1)) {
+    return detail::submit_for_result(executor, [=, obuf = obuf, runtime_spec = detail::single_threaded(runtime_spec)]() mutable {
+        return oneshot(input_rate, output_rate, num_channels, ibuf, obuf, io_spec, quality_spec, runtime_spec);
+    });
+}
+
+/**
+ * Run the `oneshot` overload that allocates its output as a task on `executor`. The input buffer must stay valid until the future
+ * is ready. soxr's own threads are disabled, as for the other overload.
+ * @param executor where to run the call, see `Executor`
+ * @param input_rate sample rate of the input
+ * @param output_rate target sample rate of the resampled output
+ * @param num_channels channel count
+ * @param ibuf buffer containing input samples
+ * @param io_spec input/output configuration
+ * @param quality_spec resampling quality configuration
+ * @param runtime_spec runtime configuration
+ * @return A future for the resampled samples, which rethrows any `SoxrError` from `get()`.
+ */
+template <Executor ExecutorType,
+          typename InputType = float,
+          typename OutputType = float,
+          size_t InputChannels = 1,
+          size_t InputExtent = std::dynamic_extent,
+          SoxrDataShape InputShape = SoxrDataShape::Interleaved,
+          SoxrDataShape OutputShape = SoxrDataShape::Interleaved>
+std::future<std::vector<OutputType>> oneshot_async(
+    ExecutorType& executor,
+    double input_rate,
+    double output_rate,
+    unsigned int num_channels,
+    const SoxrBuffer<InputType, InputChannels, InputExtent>& ibuf,
+    const SoxrIoSpec<InputType, InputShape, OutputType, OutputShape>& io_spec =
+        SoxrIoSpec<float, SoxrDataShape::Interleaved, float, SoxrDataShape::Interleaved>(),
+    const SoxrQualitySpec& quality_spec = SoxrQualitySpec(SoxrQualityRecipe::Low, 0),
+    const SoxrRuntimeSpec& runtime_spec = SoxrRuntimeSpec(1)) {
+    return detail::submit_for_result(executor, [=, runtime_spec = detail::single_threaded(runtime_spec)] {
+        return oneshot(input_rate, output_rate, num_channels, ibuf, io_spec, quality_spec, runtime_spec);
+    });
+}
+
+} // namespace soxrpp
@@ -0,0 +1,208 @@
+#pragma once
+
+#include "soxrpp.h"
+#include "soxrpp/thread_pool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace soxrpp {
+
+/**
+ * Timing and load figures for one or more batches run by a `SoxResamplerBatch`.
+ */
+struct SoxResamplerBatchStats {
+    size_t batches;             // Number of batches
+    size_t jobs;                // Number of jobs across all batches
+    size_t threads;             // Threads in the pool
+    size_t max_jobs_per_thread; // Most jobs run by a single thread in any batch, stolen ones included
+    size_t steals;              // Times a thread stole jobs from another thread's queue
+    double wall_seconds;        // Time from submitting to finishing the batches
+    double busy_seconds;        // Time spent inside process() summed over all jobs
+
+    // Fraction of the pool's capacity that was spent resampling; low values mean the pool is larger than it needs to be
+    double utilization() const noexcept {
+        return wall_seconds > 0 ? busy_seconds / (wall_seconds * threads) : 0;
+    }
+};
+
+/**
+ * Owns many independent stream resamplers and processes one block for each of them per tick on a work-stealing `ThreadPool`. Suited
+ * to serving a large number of concurrent low-rate streams, where the work per stream is too small to parallelize on its own.
+ */
+template <typename InputType = float,
+          typename OutputType = float,
+          SoxrDataShape InputShape = SoxrDataShape::Interleaved,
+          SoxrDataShape OutputShape = SoxrDataShape::Interleaved>
+class SoxResamplerBatch {
+  public:
+    using Resampler = SoxResampler<InputType, OutputType, InputShape, OutputShape>;
+    using IoSpec = SoxrIoSpec<InputType, InputShape, OutputType, OutputShape>;
+    using StreamId = size_t;
+
+    /**
+     * One block of work for one stream.
+     */
+    template <size_t InputChannels = 1, size_t OutputChannels = 1>
+    struct Job {
+        StreamId stream;
+        SoxrBuffer<InputType, InputChannels> ibuf;
+        SoxrBuffer<OutputType, OutputChannels> obuf;
+        bool done = false;
+    };
+
+    /**
+     * Outcome of one job, in the same order as the submitted jobs.
+     */
+    struct Result {
+        StreamId stream;
+        size_t idone;
+        size_t odone;
+    };
+
+  private:
+    struct Stream {
+        Resampler resampler;
+        // Last batch the stream was submitted in, to reject batches that contain a stream twice
+        size_t batch;
+    };
+
+    std::unordered_map<StreamId, Stream> m_streams;
+    StreamId m_next_id{0};
+    size_t m_batch{0};
+    std::unique_ptr<ThreadPool> m_pool;
+    SoxResamplerBatchStats m_last{};
+    SoxResamplerBatchStats m_total{};
+
+  public:
+    /**
+     * Creates an empty batch.
+     * @param num_threads number of threads to process streams on, including the caller of `process`; 0 uses one per core
+     */
+    explicit SoxResamplerBatch(unsigned int num_threads = 0)
+        : m_pool(std::make_unique<ThreadPool>(num_threads)) //
+    {
+        m_total.threads = m_pool->size();
+    }
+
+    /**
+     * Creates a stream resampler owned by the batch. Arguments are the same as for the `SoxResampler` constructor.
+     * @param input_rate sample rate of the input
+     * @param output_rate target sample rate of the resampled output
+     * @param num_channels channel count
+     * @param io_spec input/output configuration
+     * @param quality_spec resampling quality configuration
+     * @param runtime_spec runtime configuration
+     * @return The id used to refer to the stream in jobs.
+     */
+    StreamId add_stream(double input_rate,
+                        double output_rate,
+                        unsigned int num_channels,
+                        const IoSpec& io_spec = IoSpec(),
+                        const SoxrQualitySpec& quality_spec = SoxrQualitySpec(SoxrQualityRecipe::High, 0),
+                        const SoxrRuntimeSpec& runtime_spec = SoxrRuntimeSpec(1)) {
+        StreamId id = m_next_id++;
+        m_streams.emplace(id, Stream{Resampler(input_rate, output_rate, num_channels, io_spec, quality_spec, runtime_spec), 0});
+        return id;
+    }
+
+    /**
+     * Deletes a stream resampler. Must not be called while `process` is running.
+     */
+    void remove_stream(StreamId id) {
+        m_streams.erase(id);
+    }
+
+    /**
+     * Access the resampler of a stream, for example to query its delay or clear it.
+     */
+    Resampler& stream(StreamId id) {
+        auto it = m_streams.find(id);
+        if (it == m_streams.end()) {
+            throw SoxrError("Unknown stream id");
+        }
+        return it->second.resampler;
+    }
+
+    /**
+     * Query the number of streams owned by the batch.
+     */
+    size_t size() const noexcept {
+        return m_streams.size();
+    }
+
+    /**
+     * Runs `process` on every job's stream in parallel and waits for all of them to finish. Each stream may appear at most once per
+     * batch. If a job throws, the first exception is rethrown after the other jobs are done.
+     * @param jobs the input and output buffers for each stream, see `SoxResampler::process`
+     * @return The stream id and (`idone`, `odone`) for each job, in the same order as `jobs`.
+     */
+    template <size_t InputChannels, size_t OutputChannels>
+    std::vector<Result> process(const std::vector<Job<InputChannels, OutputChannels>>& jobs) {
+        const size_t batch = ++m_batch;
+        std::vector<Stream*> streams(jobs.size());
+        for (size_t i = 0; i < jobs.size(); i++) {
+            auto it = m_streams.find(jobs[i].stream);
+            if (it == m_streams.end()) {
+                throw SoxrError("Unknown stream id");
+            }
+            if (it->second.batch == batch) {
+                throw SoxrError("Stream appears more than once in a batch");
+            }
+            it->second.batch = batch;
+            streams[i] = &it->second;
+        }
+
+        std::vector<Result> results(jobs.size());
+        std::vector<double> busy(jobs.size());
+        const size_t steals = m_pool->steals();
+        const auto start = std::chrono::steady_clock::now();
+        m_pool->parallel_for(jobs.size(), [&](size_t i) {
+            const auto job_start = std::chrono::steady_clock::now();
+            auto obuf = jobs[i].obuf;
+            auto [idone, odone] = streams[i]->resampler.process(jobs[i].ibuf, obuf, jobs[i].done);
+            results[i] = Result{jobs[i].stream, idone, odone};
+            busy[i] = std::chrono::duration<double>(std::chrono::steady_clock::now() - job_start).count();
+        });
+
+        m_last = SoxResamplerBatchStats{
+            .batches = 1,
+            .jobs = jobs.size(),
+            .threads = m_pool->size(),
+            .max_jobs_per_thread = m_pool->max_tasks_per_thread(),
+            .steals = m_pool->steals() - steals,
+            .wall_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(),
+            .busy_seconds = 0,
+        };
+        for (double seconds : busy) {
+            m_last.busy_seconds += seconds;
+        }
+        m_total.batches++;
+        m_total.jobs += m_last.jobs;
+        m_total.max_jobs_per_thread = std::max(m_total.max_jobs_per_thread, m_last.max_jobs_per_thread);
+        m_total.steals += m_last.steals;
+        m_total.wall_seconds += m_last.wall_seconds;
+        m_total.busy_seconds += m_last.busy_seconds;
+        return results;
+    }
+
+    /**
+     * Query the statistics of the most recent batch.
+     */
+    const SoxResamplerBatchStats& last_stats() const noexcept {
+        return m_last;
+    }
+
+    /**
+     * Query the statistics accumulated over all batches so far.
+     */
+    const SoxResamplerBatchStats& total_stats() const noexcept {
+        return m_total;
+    }
+};
+
+} // namespace soxrpp
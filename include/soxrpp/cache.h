@@ -0,0 +1,303 @@
+#pragma once
+
+#include "soxrpp.h"
+
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <utility>
+
+namespace soxrpp {
+
+/**
+ * Snapshot of the counters kept by a `ResamplerCache`.
+ */
+struct ResamplerCacheStats {
+    size_t hits;      // Acquisitions served by an idle resampler
+    size_t misses;    // Acquisitions that had to create a new resampler
+    size_t evictions; // Idle resamplers deleted to stay within capacity
+    size_t idle;      // Resamplers currently held by the cache
+};
+
+/**
+ * Thread-safe pool of stream resamplers keyed by their full configuration. Creating a resampler designs its filters and sets up its
+ * DFTs, which can easily cost more than resampling a short signal, so reusing resamplers across calls with the same configuration
+ * avoids paying that price every time. Idle resamplers are evicted in least-recently-used order once more than `capacity` of them
+ * are held by the cache.
+ */
+template <typename InputType = float,
+          typename OutputType = float,
+          SoxrDataShape InputShape = SoxrDataShape::Interleaved,
+          SoxrDataShape OutputShape = SoxrDataShape::Interleaved>
+class ResamplerCache {
+  public:
+    using Resampler = SoxResampler<InputType, OutputType, InputShape, OutputShape>;
+    using IoSpec = SoxrIoSpec<InputType, InputShape, OutputType, OutputShape>;
+
+  private:
+    // (input_rate, output_rate, num_channels, io_spec, quality_spec, runtime_spec), flattened so that it is ordered
+    using Key = std::tuple<double,
+                           double,
+                           unsigned int,
+                           double,
+                           unsigned long,
+                           double,
+                           double,
+                           double,
+                           double,
+                           unsigned long,
+                           unsigned int,
+                           unsigned int,
+                           unsigned int,
+                           unsigned int,
+                           unsigned long>;
+    using Entry = std::pair<Key, std::unique_ptr<Resampler>>;
+
+    mutable std::mutex m_mutex;
+    size_t m_capacity;
+    // Idle resamplers, most recently used first
+    std::list<Entry> m_idle;
+    std::multimap<Key, typename std::list<Entry>::iterator> m_index;
+    size_t m_hits{0};
+    size_t m_misses{0};
+    size_t m_evictions{0};
+
+    static Key make_key(double input_rate,
+                        double output_rate,
+                        unsigned int num_channels,
+                        const IoSpec& io_spec,
+                        const SoxrQualitySpec& quality_spec,
+                        const SoxrRuntimeSpec& runtime_spec) noexcept {
+        return Key(input_rate,
+                   output_rate,
+                   num_channels,
+                   io_spec.scale,
+                   io_spec.flags,
+                   quality_spec.precision,
+                   quality_spec.phase_response,
+                   quality_spec.passband_end,
+                   quality_spec.stopband_begin,
+                   quality_spec.flags,
+                   runtime_spec.log2_min_dft_size,
+                   runtime_spec.log2_large_dft_size,
+                   runtime_spec.coef_size_kbytes,
+                   runtime_spec.num_threads,
+                   runtime_spec.flags);
+    }
+
+    // Must be called with m_mutex held
+    void evict_to(size_t capacity) noexcept {
+        while (m_idle.size() > capacity) {
+            auto last = std::prev(m_idle.end());
+            auto [first, end] = m_index.equal_range(last->first);
+            for (auto it = first; it != end; it++) {
+                if (it->second == last) {
+                    m_index.erase(it);
+                    break;
+                }
+            }
+            m_idle.erase(last);
+            m_evictions++;
+        }
+    }
+
+    // Called from `Lease`'s destructor, so it discards the resampler rather than throwing
+    void release(Key key, std::unique_ptr<Resampler> resampler) {
+        if (!resampler->try_clear()) {
+            // A resampler that can't be reset isn't safe to hand out again
+            return;
+        }
+        try {
+            std::lock_guard lock(m_mutex);
+            m_idle.emplace_front(key, std::move(resampler));
+            try {
+                m_index.emplace(std::move(key), m_idle.begin());
+            } catch (...) {
+                m_idle.pop_front();
+                throw;
+            }
+            evict_to(m_capacity);
+        } catch (...) {
+            // Out of memory for the bookkeeping, so the resampler is destroyed instead of kept
+        }
+    }
+
+  public:
+    /**
+     * Handle to a resampler borrowed from the cache. The resampler is reset with `clear` and returned to the cache when the lease is
+     * destroyed, so the lease must not outlive the cache. Don't reconfigure the channel count of a leased resampler.
+     */
+    class Lease {
+      private:
+        ResamplerCache* m_cache;
+        Key m_key;
+        std::unique_ptr<Resampler> m_resampler;
+
+        friend class ResamplerCache;
+
+        Lease(ResamplerCache* cache, Key key, std::unique_ptr<Resampler> resampler) noexcept
+            : m_cache(cache)
+            , m_key(std::move(key))
+            , m_resampler(std::move(resampler)) {}
+
+      public:
+        Lease(const Lease&) = delete;
+        Lease& operator=(const Lease&) = delete;
+
+        Lease(Lease&& other) noexcept
+            : m_cache(other.m_cache)
+            , m_key(std::move(other.m_key))
+            , m_resampler(std::move(other.m_resampler)) {}
+
+        Lease& operator=(Lease&& other) noexcept {
+            if (this != &other) {
+                reset();
+                m_cache = other.m_cache;
+                m_key = std::move(other.m_key);
+                m_resampler = std::move(other.m_resampler);
+            }
+            return *this;
+        }
+
+        ~Lease() {
+            reset();
+        }
+
+        /**
+         * Return the resampler to the cache early. The lease is empty afterwards.
+         */
+        void reset() noexcept {
+            if (m_resampler) {
+                m_cache->release(std::move(m_key), std::move(m_resampler));
+            }
+        }
+
+        Resampler& operator*() const noexcept {
+            return *m_resampler;
+        }
+
+        Resampler* operator->() const noexcept {
+            return m_resampler.get();
+        }
+    };
+
+    /**
+     * Creates an empty cache.
+     * @param capacity maximum number of idle resamplers to keep
+     */
+    explicit ResamplerCache(size_t capacity = 16)
+        : m_capacity(capacity) {}
+
+    ResamplerCache(const ResamplerCache&) = delete;
+    ResamplerCache& operator=(const ResamplerCache&) = delete;
+
+    /**
+     * Borrow a resampler with the given configuration, creating one if no idle resampler matches. Arguments are the same as for the
+     * `SoxResampler` constructor.
+     * @param input_rate sample rate of the input
+     * @param output_rate target sample rate of the resampled output
+     * @param num_channels channel count
+     * @param io_spec input/output configuration
+     * @param quality_spec resampling quality configuration
+     * @param runtime_spec runtime configuration
+     */
+    Lease acquire(double input_rate,
+                  double output_rate,
+                  unsigned int num_channels,
+                  const IoSpec& io_spec = IoSpec(),
+                  const SoxrQualitySpec& quality_spec = SoxrQualitySpec(SoxrQualityRecipe::High, 0),
+                  const SoxrRuntimeSpec& runtime_spec = SoxrRuntimeSpec(1)) {
+        Key key = make_key(input_rate, output_rate, num_channels, io_spec, quality_spec, runtime_spec);
+        {
+            std::lock_guard lock(m_mutex);
+            auto it = m_index.find(key);
+            if (it != m_index.end()) {
+                std::unique_ptr<Resampler> resampler = std::move(it->second->second);
+                m_idle.erase(it->second);
+                m_index.erase(it);
+                m_hits++;
+                return Lease(this, std::move(key), std::move(resampler));
+            }
+            m_misses++;
+        }
+        // Don't hold the lock while designing filters
+        auto resampler = std::make_unique<Resampler>(input_rate, output_rate, num_channels, io_spec, quality_spec, runtime_spec);
+        return Lease(this, std::move(key), std::move(resampler));
+    }
+
+    /**
+     * Query the hit/miss/eviction counters and the number of idle resamplers.
+     */
+    ResamplerCacheStats stats() const {
+        std::lock_guard lock(m_mutex);
+        return ResamplerCacheStats{
+            .hits = m_hits,
+            .misses = m_misses,
+            .evictions = m_evictions,
+            .idle = m_idle.size(),
+        };
+    }
+
+    /**
+     * Change the maximum number of idle resamplers, evicting the least recently used ones if needed.
+     * @param capacity new capacity
+     */
+    void set_capacity(size_t capacity) {
+        std::lock_guard lock(m_mutex);
+        m_capacity = capacity;
+        evict_to(m_capacity);
+    }
+
+    /**
+     * Delete all idle resamplers. Outstanding leases are unaffected.
+     */
+    void clear() {
+        std::lock_guard lock(m_mutex);
+        m_index.clear();
+        m_idle.clear();
+    }
+};
+
+/**
+ * Resample a (probably short) signal held entirely in memory, reusing a resampler from `cache` instead of creating a new one. Behaves
+ * like `oneshot`, including its lower default quality.
+ * @param cache pool to borrow the resampler from
+ * @param input_rate sample rate of the input
+ * @param output_rate target sample rate of the resampled output
+ * @param num_channels channel count
+ * @param ibuf buffer containing input samples
+ * @param obuf buffer to write output samples
+ * @param io_spec input/output configuration
+ * @param quality_spec resampling quality configuration
+ * @param runtime_spec runtime configuration
+ */
+template <size_t InputChannels,
+          size_t OutputChannels,
+          typename InputType,
+          typename OutputType,
+          size_t InputExtent,
+          size_t OutputExtent,
+          SoxrDataShape InputShape,
+          SoxrDataShape OutputShape>
+inline std::pair<size_t, size_t> oneshot(ResamplerCache<InputType, OutputType, InputShape, OutputShape>& cache,
+                                         double input_rate,
+                                         double output_rate,
+                                         unsigned int num_channels,
+                                         const SoxrBuffer<InputType, InputChannels, InputExtent>& ibuf,
+                                         SoxrBuffer<OutputType, OutputChannels, OutputExtent>& obuf,
+                                         const SoxrIoSpec<InputType, InputShape, OutputType, OutputShape>& io_spec =
+                                             SoxrIoSpec<InputType, InputShape, OutputType, OutputShape>(),
+                                         const SoxrQualitySpec& quality_spec = SoxrQualitySpec(SoxrQualityRecipe::Low, 0),
+                                         const SoxrRuntimeSpec& runtime_spec = SoxrRuntimeSpec(1)) {
+    constexpr bool output_interleaved = OutputShape == SoxrDataShape::Interleaved;
+    auto resampler = cache.acquire(input_rate, output_rate, num_channels, io_spec, quality_spec, runtime_spec);
+    auto [idone, odone] = resampler->process(ibuf, obuf);
+    // Flush the remaining output into whatever space is left
+    auto rest = obuf.advance(odone, output_interleaved, num_channels);
+    auto [_, oflushed] = resampler->process(ibuf, rest, true);
+    return std::make_pair(idone, odone + oflushed);
+}
+
+} // namespace soxrpp
@@ -0,0 +1,303 @@
+#pragma once
+
+#include "soxrpp.h"
+#include "soxrpp/thread_pool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+namespace soxrpp {
+
+namespace detail {
+
+// Full-scale value of an integer sample type, as soxr scales it to and from floating point
+template <typename Type>
+constexpr double full_scale() noexcept {
+    return -(double)std::numeric_limits<Type>::min();
+}
+
+template <typename From, typename To>
+void convert_samples(const From* src, To* dst, size_t count, size_t& clips) noexcept {
+    if constexpr (std::is_floating_point_v<From> && std::is_floating_point_v<To>) {
+        std::copy_n(src, count, dst);
+    } else if constexpr (std::is_floating_point_v<To>) {
+        constexpr To scale = To(1 / full_scale<From>());
+        for (size_t i = 0; i < count; i++) {
+            dst[i] = (To)src[i] * scale;
+        }
+    } else {
+        constexpr double scale = full_scale<To>();
+        constexpr double low = std::numeric_limits<To>::min();
+        constexpr double high = std::numeric_limits<To>::max();
+        for (size_t i = 0; i < count; i++) {
+            double x = std::nearbyint((double)src[i] * scale);
+            if (x < low || x > high) {
+                clips++;
+                x = std::clamp(x, low, high);
+            }
+            dst[i] = (To)x;
+        }
+    }
+}
+
+} // namespace detail
+
+/**
+ * Resamples one interleaved input stream to several output rates at once, for publishing the same stream at, say, 48 kHz, 44.1 kHz,
+ * 16 kHz and 8 kHz. Compared with one `SoxResampler` per rate, the input is read and converted to floating point once per block
+ * instead of once per rate, and with `cascade` enabled, an output whose rate divides a higher output rate is resampled from that
+ * output rather than from the input (8 kHz from 16 kHz from 48 kHz), which makes its filter shorter and its input smaller. Outputs
+ * that don't depend on each other run in parallel when a thread count above 1 is given.
+ *
+ * Each `process` call consumes up to `block_frames` input frames, after which every output's new frames are available from
+ * `output(i)` until the next call. All processing is done in `float`, or in `double` for `double` input; integer outputs are rounded
+ * and clipped without dither.
+ */
+template <typename InputType = float, typename OutputType = float>
+class FanoutResampler {
+    static_assert(!std::is_const_v<OutputType>, "OutputType cannot be const");
+
+  private:
+    using RawInputType = std::remove_const_t<InputType>;
+    using Work = std::conditional_t<std::is_same_v<RawInputType, double>, double, float>;
+    using Resampler = SoxResampler<const Work, Work>;
+    using IoSpec = SoxrIoSpec<const Work, SoxrDataShape::Interleaved, Work, SoxrDataShape::Interleaved>;
+    static constexpr bool convert_input = !std::is_same_v<RawInputType, Work>;
+    static constexpr bool convert_output = !std::is_same_v<OutputType, Work>;
+
+    struct Stage {
+        double output_rate;
+        // Index of the stage this one is resampled from, or npos for the input
+        size_t source;
+        Resampler resampler;
+        std::vector<Work> block;
+        size_t frames{0};
+        std::vector<OutputType> converted;
+        size_t clips{0};
+    };
+
+    double m_input_rate;
+    unsigned int m_num_channels;
+    size_t m_block_frames;
+    std::vector<Stage> m_stages;
+    // Stage indices grouped so that every stage's source is in an earlier level
+    std::vector<std::vector<size_t>> m_levels;
+    std::vector<Work> m_input_block;
+    std::unique_ptr<ThreadPool> m_pool;
+
+    // Resamples all of `frames` frames of `input` into the stage's block after what is already there. The block grows as needed,
+    // so nothing is left behind in soxr
+    void feed(Stage& stage, const Work* input, size_t frames, bool done) {
+        const double ratio = stage.output_rate / (stage.source == npos ? m_input_rate : m_stages[stage.source].output_rate);
+        size_t consumed = 0;
+        while (true) {
+            const size_t wanted = stage.frames + (size_t)std::ceil((frames - consumed) * ratio) + 64;
+            if (stage.block.size() < wanted * m_num_channels) {
+                stage.block.resize(std::max(wanted * m_num_channels, 2 * stage.block.size()));
+            }
+            const size_t room = stage.block.size() / m_num_channels - stage.frames;
+            SoxrBuffer<const Work> ibuf(input + consumed * m_num_channels, (frames - consumed) * m_num_channels);
+            SoxrBuffer<Work> obuf(stage.block.data() + stage.frames * m_num_channels, room * m_num_channels);
+            auto [idone, odone] = stage.resampler.process(ibuf, obuf, done);
+            consumed += idone;
+            stage.frames += odone;
+            // soxr leaves room in the output only once it has nothing more to give for this input
+            if (odone < room && (done ? odone == 0 : consumed == frames)) {
+                break;
+            }
+        }
+    }
+
+    void run_stage(Stage& stage, const Work* input, size_t frames, bool done) {
+        stage.frames = 0;
+        feed(stage, input, frames, false);
+        // The source's last output has to go in before the flush, since soxr ignores the input passed along with `done`
+        if (done) {
+            feed(stage, input, 0, true);
+        }
+        if constexpr (convert_output) {
+            stage.converted.resize(stage.block.size());
+            detail::convert_samples(stage.block.data(), stage.converted.data(), stage.frames * m_num_channels, stage.clips);
+        }
+    }
+
+  public:
+    static constexpr size_t npos = (size_t)-1;
+
+    /**
+     * Creates a fan-out resampler.
+     * @param input_rate sample rate of the input
+     * @param output_rates sample rate of each output, in the order `output` indexes them
+     * @param num_channels channel count, the same for the input and every output
+     * @param block_frames largest number of input frames consumed per `process` call
+     * @param cascade whether to resample an output from a higher output whose rate is an integer multiple of its own
+     * @param num_threads number of threads to run independent outputs on, including the caller; 1 runs everything on the caller, 0
+     * uses one per core
+     * @param quality_spec resampling quality configuration, used for every output
+     * @param runtime_spec runtime configuration, used for every output
+     */
+    FanoutResampler(double input_rate,
+                    const std::vector<double>& output_rates,
+                    unsigned int num_channels,
+                    size_t block_frames = 1024,
+                    bool cascade = true,
+                    unsigned int num_threads = 1,
+                    const SoxrQualitySpec& quality_spec = SoxrQualitySpec(SoxrQualityRecipe::High, 0),
+                    const SoxrRuntimeSpec& runtime_spec = SoxrRuntimeSpec(1))
+        : m_input_rate(input_rate)
+        , m_num_channels(num_channels)
+        , m_block_frames(block_frames) //
+    {
+        if (output_rates.empty() || block_frames == 0) {
+            throw SoxrError("A fan-out needs at least one output and one frame per block");
+        }
+        std::vector<size_t> sources(output_rates.size(), npos);
+        std::vector<size_t> depths(output_rates.size(), 0);
+        if (cascade) {
+            // Chain each rate to the lowest higher output rate that is a whole multiple of it, which is the cheapest to filter
+            for (size_t i = 0; i < output_rates.size(); i++) {
+                for (size_t j = 0; j < output_rates.size(); j++) {
+                    const double multiple = output_rates[j] / output_rates[i];
+                    const bool whole = multiple > 1 && multiple == std::floor(multiple) && output_rates[j] < input_rate;
+                    if (whole && (sources[i] == npos || output_rates[j] < output_rates[sources[i]])) {
+                        sources[i] = j;
+                    }
+                }
+            }
+        }
+        m_stages.reserve(output_rates.size());
+        for (size_t i = 0; i < output_rates.size(); i++) {
+            double stage_input_rate = sources[i] == npos ? input_rate : output_rates[sources[i]];
+            m_stages.push_back(Stage{
+                .output_rate = output_rates[i],
+                .source = sources[i],
+                .resampler = Resampler(stage_input_rate, output_rates[i], num_channels, IoSpec(), quality_spec, runtime_spec),
+            });
+            m_stages.back().block.resize(((size_t)std::ceil(block_frames * output_rates[i] / input_rate) + 64) * num_channels);
+            for (size_t s = sources[i]; s != npos; s = sources[s]) {
+                depths[i]++;
+            }
+        }
+        m_levels.resize(*std::max_element(depths.begin(), depths.end()) + 1);
+        for (size_t i = 0; i < m_stages.size(); i++) {
+            m_levels[depths[i]].push_back(i);
+        }
+        if constexpr (convert_input) {
+            m_input_block.resize(block_frames * num_channels);
+        }
+        if (num_threads != 1) {
+            m_pool = std::make_unique<ThreadPool>(num_threads);
+        }
+    }
+
+    /**
+     * Resamples the next input frames to every output rate. Consumes up to `block_frames` frames of `ibuf` and replaces the contents
+     * of every `output` with the frames produced from them; call again with the rest of `ibuf` if it is longer.
+     * @param ibuf readonly buffer of interleaved input frames
+     * @param done true if there are no input samples and no more will be available, to flush every output
+     * @return The number of input frames consumed.
+     */
+    template <size_t Extent = std::dynamic_extent>
+    size_t process(const SoxrBuffer<InputType, 1, Extent>& ibuf, bool done = false) {
+        const size_t frames = done ? 0 : std::min(m_block_frames, ibuf.size(true, m_num_channels));
+        const Work* input = nullptr;
+        if constexpr (convert_input) {
+            size_t clips = 0;
+            detail::convert_samples(ibuf.channel(0), m_input_block.data(), frames * m_num_channels, clips);
+            input = m_input_block.data();
+        } else {
+            input = ibuf.channel(0);
+        }
+
+        for (const std::vector<size_t>& level : m_levels) {
+            auto run = [&](size_t k) {
+                Stage& stage = m_stages[level[k]];
+                if (stage.source == npos) {
+                    run_stage(stage, input, frames, done);
+                } else {
+                    const Stage& source = m_stages[stage.source];
+                    run_stage(stage, source.block.data(), source.frames, done);
+                }
+            };
+            if (m_pool != nullptr && level.size() > 1) {
+                m_pool->parallel_for(level.size(), run);
+            } else {
+                for (size_t k = 0; k < level.size(); k++) {
+                    run(k);
+                }
+            }
+        }
+        return frames;
+    }
+
+    /**
+     * Access the interleaved frames produced for output `i` by the last `process` call.
+     */
+    std::span<const OutputType> output(size_t i) const noexcept {
+        const Stage& stage = m_stages[i];
+        if constexpr (convert_output) {
+            return std::span<const OutputType>(stage.converted.data(), stage.frames * m_num_channels);
+        } else {
+            return std::span<const OutputType>(stage.block.data(), stage.frames * m_num_channels);
+        }
+    }
+
+    /**
+     * Query the number of outputs.
+     */
+    size_t num_outputs() const noexcept {
+        return m_stages.size();
+    }
+
+    /**
+     * Query the sample rate of output `i`.
+     */
+    double output_rate(size_t i) const noexcept {
+        return m_stages[i].output_rate;
+    }
+
+    /**
+     * Query the index of the output that output `i` is cascaded from, or `npos` if it is resampled from the input.
+     */
+    size_t source(size_t i) const noexcept {
+        return m_stages[i].source;
+    }
+
+    /**
+     * Query the delay of output `i`, in its output samples, including that of any outputs it is cascaded from.
+     */
+    double delay(size_t i) noexcept {
+        double delay = 0;
+        double rate = m_stages[i].output_rate;
+        for (size_t s = i; s != npos; s = m_stages[s].source) {
+            delay += m_stages[s].resampler.delay() * rate / m_stages[s].output_rate;
+        }
+        return delay;
+    }
+
+    /**
+     * Query the number of samples of output `i` that clipped when converting to an integer `OutputType`.
+     */
+    size_t num_clips(size_t i) const noexcept {
+        return m_stages[i].clips;
+    }
+
+    /**
+     * Prepare to process a fresh signal with the same config.
+     */
+    void clear() {
+        for (Stage& stage : m_stages) {
+            stage.resampler.clear();
+            stage.frames = 0;
+            stage.clips = 0;
+        }
+    }
+};
+
+} // namespace soxrpp
@@ -0,0 +1,406 @@
+#pragma once
+
+#include "soxrpp.h"
+
+#include <algorithm>
+#include <bit>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace soxrpp {
+
+// Sample encodings that can be read and written by `resample_file`, matching the types soxr supports
+enum class PcmSampleType { Int16, Int32, Float32, Float64 };
+
+enum class PcmContainer {
+    // Headerless interleaved samples
+    Raw,
+    // RIFF/WAVE with PCM or IEEE float samples
+    Wav
+};
+
+/**
+ * Describes the samples in a file. For WAV input, the type, rate and channel count are read from the header instead.
+ */
+struct PcmFileSpec {
+    PcmContainer container = PcmContainer::Wav;
+    PcmSampleType type = PcmSampleType::Float32;
+    double rate = 0;               // Sample rate
+    unsigned int num_channels = 0; // Channel count; 0 for the output means the same as the input
+};
+
+struct ResampleFileResult {
+    size_t input_frames;  // Frames read from the input file
+    size_t output_frames; // Frames written to the output file
+    size_t clips;         // Samples that clipped; only counted for integer output
+};
+
+namespace detail {
+
+inline SoxrError system_error(const std::string& what, const std::string& path) {
+    return SoxrError(what + " '" + path + "': " + strerror(errno));
+}
+
+// Owns a file descriptor and, optionally, a mapping of the whole file
+class MappedFile {
+  private:
+    std::string m_path;
+    int m_fd{-1};
+    unsigned char* m_data{nullptr};
+    size_t m_size{0};
+
+    // The destructor doesn't run when the constructor throws, so the descriptor is closed here
+    SoxrError close_with_error(const std::string& what) {
+        SoxrError err = system_error(what, m_path);
+        close(m_fd);
+        m_fd = -1;
+        return err;
+    }
+
+  public:
+    MappedFile(const std::string& path, bool writable, size_t size = 0)
+        : m_path(path) //
+    {
+        m_fd = writable ? open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644) : open(path.c_str(), O_RDONLY);
+        if (m_fd < 0) {
+            throw system_error("Could not open", path);
+        }
+        if (writable) {
+            if (ftruncate(m_fd, size) != 0) {
+                throw close_with_error("Could not allocate");
+            }
+        } else {
+            struct stat info;
+            if (fstat(m_fd, &info) != 0) {
+                throw close_with_error("Could not stat");
+            }
+            size = info.st_size;
+        }
+        m_size = size;
+        if (m_size > 0) {
+            void* data = mmap(nullptr, m_size, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, m_fd, 0);
+            if (data == MAP_FAILED) {
+                throw close_with_error("Could not map");
+            }
+            m_data = static_cast<unsigned char*>(data);
+            // Pages are touched once, front to back
+            madvise(m_data, m_size, MADV_SEQUENTIAL);
+        }
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile() {
+        unmap();
+        if (m_fd >= 0) {
+            close(m_fd);
+        }
+    }
+
+    unsigned char* data() const noexcept {
+        return m_data;
+    }
+
+    size_t size() const noexcept {
+        return m_size;
+    }
+
+    // Drops the pages of [0, end) from this process; they stay in the page cache and dirty ones are still written back
+    void release(size_t end) const noexcept {
+        static const size_t page = sysconf(_SC_PAGESIZE);
+        end = std::min(end, m_size) / page * page;
+        if (end > 0) {
+            madvise(m_data, end, MADV_DONTNEED);
+        }
+    }
+
+    void unmap() noexcept {
+        if (m_data != nullptr) {
+            munmap(m_data, m_size);
+            m_data = nullptr;
+        }
+    }
+
+    // Unmaps and shrinks the file to `size` bytes
+    void truncate(size_t size) {
+        unmap();
+        if (ftruncate(m_fd, size) != 0) {
+            throw system_error("Could not truncate", m_path);
+        }
+    }
+};
+
+// Whether two paths name the same existing file, through links or otherwise
+inline bool same_file(const std::string& a, const std::string& b) noexcept {
+    struct stat a_info;
+    struct stat b_info;
+    return stat(a.c_str(), &a_info) == 0 && stat(b.c_str(), &b_info) == 0 && a_info.st_dev == b_info.st_dev &&
+           a_info.st_ino == b_info.st_ino;
+}
+
+inline size_t sample_size(PcmSampleType type) noexcept {
+    switch (type) {
+    case PcmSampleType::Int16:
+        return 2;
+    case PcmSampleType::Int32:
+    case PcmSampleType::Float32:
+        return 4;
+    default:
+        return 8;
+    }
+}
+
+// Calls `fn` with a value of the C++ type that matches `type`
+template <typename Fn>
+decltype(auto) visit_sample_type(PcmSampleType type, Fn&& fn) {
+    switch (type) {
+    case PcmSampleType::Int16:
+        return fn(int16_t{});
+    case PcmSampleType::Int32:
+        return fn(int32_t{});
+    case PcmSampleType::Float32:
+        return fn(float{});
+    default:
+        return fn(double{});
+    }
+}
+
+inline uint32_t read_le32(const unsigned char* p) noexcept {
+    return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+inline uint16_t read_le16(const unsigned char* p) noexcept {
+    return p[0] | p[1] << 8;
+}
+
+inline void write_le32(unsigned char* p, uint32_t value) noexcept {
+    for (int i = 0; i < 4; i++) {
+        p[i] = value >> (8 * i);
+    }
+}
+
+inline void write_le16(unsigned char* p, uint16_t value) noexcept {
+    p[0] = value;
+    p[1] = value >> 8;
+}
+
+// Finds the sample data of a WAV file and fills in `spec` from its fmt chunk. Returns the (offset, size) of the data in bytes.
+inline std::pair<size_t, size_t> parse_wav(const unsigned char* data, size_t size, PcmFileSpec& spec) {
+    if (size < 12 || memcmp(data, "RIFF", 4) != 0 || memcmp(data + 8, "WAVE", 4) != 0) {
+        throw SoxrError("Not a RIFF/WAVE file");
+    }
+    bool have_format = false;
+    size_t pos = 12;
+    while (pos + 8 <= size) {
+        const unsigned char* chunk = data + pos;
+        size_t chunk_size = read_le32(chunk + 4);
+        if (memcmp(chunk, "fmt ", 4) == 0 && chunk_size >= 16 && pos + 8 + 16 <= size) {
+            uint16_t tag = read_le16(chunk + 8);
+            if (tag == 0xfffe && chunk_size >= 40 && pos + 8 + 40 <= size) {
+                // WAVE_FORMAT_EXTENSIBLE keeps the actual format tag at the start of the subformat GUID
+                tag = read_le16(chunk + 8 + 24);
+            }
+            uint16_t bits = read_le16(chunk + 8 + 14);
+            if (tag == 1 && bits == 16) {
+                spec.type = PcmSampleType::Int16;
+            } else if (tag == 1 && bits == 32) {
+                spec.type = PcmSampleType::Int32;
+            } else if (tag == 3 && bits == 32) {
+                spec.type = PcmSampleType::Float32;
+            } else if (tag == 3 && bits == 64) {
+                spec.type = PcmSampleType::Float64;
+            } else {
+                throw SoxrError("Unsupported WAV sample format");
+            }
+            spec.num_channels = read_le16(chunk + 8 + 2);
+            spec.rate = read_le32(chunk + 8 + 4);
+            have_format = true;
+        } else if (memcmp(chunk, "data", 4) == 0) {
+            if (!have_format) {
+                throw SoxrError("WAV data chunk precedes its fmt chunk");
+            }
+            // Streamed files may leave the size unset, in which case the data runs to the end of the file
+            return std::make_pair(pos + 8, std::min(chunk_size, size - pos - 8));
+        }
+        pos += 8 + chunk_size + (chunk_size & 1);
+    }
+    throw SoxrError("WAV file has no data chunk");
+}
+
+// Size of the header written by write_wav_header; padded so that the samples are aligned to their own size
+inline size_t wav_header_size(PcmSampleType type) noexcept {
+    return type == PcmSampleType::Float64 ? 56 : 44;
+}
+
+inline void write_wav_header(unsigned char* data, const PcmFileSpec& spec, size_t data_size) {
+    const size_t header = wav_header_size(spec.type);
+    const uint16_t bytes = sample_size(spec.type);
+    const bool is_float = spec.type == PcmSampleType::Float32 || spec.type == PcmSampleType::Float64;
+    memcpy(data, "RIFF", 4);
+    write_le32(data + 4, header - 8 + data_size);
+    memcpy(data + 8, "WAVE", 4);
+    memcpy(data + 12, "fmt ", 4);
+    write_le32(data + 16, 16);
+    write_le16(data + 20, is_float ? 3 : 1);
+    write_le16(data + 22, spec.num_channels);
+    write_le32(data + 24, (uint32_t)spec.rate);
+    write_le32(data + 28, (uint32_t)spec.rate * spec.num_channels * bytes);
+    write_le16(data + 32, spec.num_channels * bytes);
+    write_le16(data + 34, 8 * bytes);
+    if (header > 44) {
+        // Readers skip unknown chunks, and this one moves the samples onto an 8-byte boundary
+        memcpy(data + 36, "JUNK", 4);
+        write_le32(data + 40, header - 52);
+        memset(data + 44, 0, header - 52);
+    }
+    memcpy(data + header - 8, "data", 4);
+    write_le32(data + header - 4, data_size);
+}
+
+template <typename InputType, typename OutputType>
+ResampleFileResult resample_mapped(const MappedFile& input,
+                                   size_t input_offset,
+                                   size_t input_frames,
+                                   const PcmFileSpec& input_spec,
+                                   MappedFile& output,
+                                   size_t output_offset,
+                                   const PcmFileSpec& output_spec,
+                                   const SoxrQualitySpec& quality_spec,
+                                   const SoxrRuntimeSpec& runtime_spec) {
+    const unsigned int num_channels = input_spec.num_channels;
+    // Bounds how much of either file is resident at once
+    const size_t block = 1 << 16;
+    const size_t release_interval = 16 << 20;
+    const size_t output_block = (size_t)(block * output_spec.rate / input_spec.rate) + 64;
+
+    SoxResampler<const InputType, OutputType> resampler(input_spec.rate,
+                                                        output_spec.rate,
+                                                        num_channels,
+                                                        SoxrIoSpec<const InputType,
+                                                                   SoxrDataShape::Interleaved,
+                                                                   OutputType,
+                                                                   SoxrDataShape::Interleaved>(),
+                                                        quality_spec,
+                                                        runtime_spec);
+    const InputType* samples = reinterpret_cast<const InputType*>(input.data() + input_offset);
+    OutputType* out = reinterpret_cast<OutputType*>(output.data() + output_offset);
+    const size_t output_capacity = (output.size() - output_offset) / (sizeof(OutputType) * num_channels);
+
+    // Samples in the input mapping are only usable in place if they are aligned; otherwise they go through a small bounce buffer
+    const bool aligned = (uintptr_t)samples % alignof(InputType) == 0;
+    std::vector<InputType> bounce(aligned ? 0 : block * num_channels);
+
+    size_t ipos = 0;
+    size_t opos = 0;
+    size_t released = 0;
+    while (true) {
+        const bool done = ipos == input_frames;
+        const size_t ilen = std::min(block, input_frames - ipos);
+        const InputType* iptr = samples + ipos * num_channels;
+        if (!aligned && ilen > 0) {
+            memcpy(bounce.data(), iptr, ilen * num_channels * sizeof(InputType));
+            iptr = bounce.data();
+        }
+        if (opos == output_capacity) {
+            throw SoxrError("Resampler produced more output than expected");
+        }
+        auto ibuf = SoxrBuffer<const InputType>(iptr, ilen * num_channels);
+        auto obuf = SoxrBuffer<OutputType>(out + opos * num_channels, std::min(output_block, output_capacity - opos) * num_channels);
+        auto [idone, odone] = resampler.process(ibuf, obuf, done);
+        ipos += idone;
+        opos += odone;
+        if (done && odone == 0) {
+            break;
+        }
+        if (ipos * num_channels * sizeof(InputType) - released > release_interval) {
+            released = ipos * num_channels * sizeof(InputType);
+            input.release(input_offset + released);
+            output.release(output_offset + opos * num_channels * sizeof(OutputType));
+        }
+    }
+    return ResampleFileResult{
+        .input_frames = ipos,
+        .output_frames = opos,
+        .clips = *resampler.num_clips(),
+    };
+}
+
+} // namespace detail
+
+/**
+ * Resample a raw PCM or WAV file into another one without reading either into memory. The input is memory-mapped and fed to the
+ * resampler in place, and output is written straight into a mapping of the preallocated output file. Pages behind the resampler are
+ * dropped as it goes, so memory use stays flat regardless of file size. Output WAV files are limited to 4 GiB of samples.
+ * @param input_path file to read
+ * @param input_spec format of the input; for WAV only `container` is used
+ * @param output_path file to create or overwrite
+ * @param output_spec format of the output; `rate` is required, `num_channels` must be 0 or match the input
+ * @param quality_spec resampling quality configuration
+ * @param runtime_spec runtime configuration
+ */
+inline ResampleFileResult resample_file(const std::string& input_path,
+                                        PcmFileSpec input_spec,
+                                        const std::string& output_path,
+                                        PcmFileSpec output_spec,
+                                        const SoxrQualitySpec& quality_spec = SoxrQualitySpec(SoxrQualityRecipe::High, 0),
+                                        const SoxrRuntimeSpec& runtime_spec = SoxrRuntimeSpec(1)) {
+    if constexpr (std::endian::native != std::endian::little) {
+        throw SoxrError("resample_file only supports little-endian hosts");
+    }
+    // Creating the output truncates it, which would pull the pages out from under the input's mapping
+    if (detail::same_file(input_path, output_path)) {
+        throw SoxrError("Cannot resample '" + input_path + "' into itself");
+    }
+    detail::MappedFile input(input_path, false);
+    size_t input_offset = 0;
+    size_t input_bytes = input.size();
+    if (input_spec.container == PcmContainer::Wav) {
+        std::tie(input_offset, input_bytes) = detail::parse_wav(input.data(), input.size(), input_spec);
+    }
+    if (input_spec.num_channels == 0 || input_spec.rate <= 0 || output_spec.rate <= 0) {
+        throw SoxrError("Sample rates and channel count must be positive");
+    }
+    if (output_spec.num_channels != 0 && output_spec.num_channels != input_spec.num_channels) {
+        throw SoxrError("resample_file cannot change the channel count");
+    }
+    output_spec.num_channels = input_spec.num_channels;
+    const size_t input_frames = input_bytes / (detail::sample_size(input_spec.type) * input_spec.num_channels);
+
+    // Leave room for rounding in the output length; the file is shrunk to fit afterwards
+    const size_t frame_size = detail::sample_size(output_spec.type) * output_spec.num_channels;
+    const size_t output_offset = output_spec.container == PcmContainer::Wav ? detail::wav_header_size(output_spec.type) : 0;
+    if (output_spec.container == PcmContainer::Wav &&
+        output_frames(input_frames, input_spec.rate, output_spec.rate) > (0xffffffff - output_offset) / frame_size) {
+        throw SoxrError("Output is too large for a WAV file");
+    }
+    const size_t max_frames = (size_t)(input_frames * output_spec.rate / input_spec.rate) + 64;
+    detail::MappedFile output(output_path, true, output_offset + max_frames * frame_size);
+
+    ResampleFileResult result = detail::visit_sample_type(input_spec.type, [&](auto input_sample) {
+        return detail::visit_sample_type(output_spec.type, [&](auto output_sample) {
+            return detail::resample_mapped<decltype(input_sample), decltype(output_sample)>(
+                input, input_offset, input_frames, input_spec, output, output_offset, output_spec, quality_spec, runtime_spec);
+        });
+    });
+
+    const size_t data_size = result.output_frames * frame_size;
+    if (output_spec.container == PcmContainer::Wav) {
+        detail::write_wav_header(output.data(), output_spec, data_size);
+    }
+    output.truncate(output_offset + data_size);
+    return result;
+}
+
+} // namespace soxrpp
@@ -0,0 +1,419 @@
+#pragma once
+
+#include "soxrpp.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace soxrpp {
+
+/**
+ * Packed little-endian 24-bit signed sample, as found in 24-bit WAV files and on AES3 links.
+ */
+struct Int24 {
+    uint8_t bytes[3];
+};
+
+/**
+ * Integer sample stored with its bytes in the opposite order from the host, for example big-endian `int16_t` on x86.
+ */
+template <typename Type>
+struct ByteSwapped {
+    static_assert(std::is_same_v<Type, int16_t> || std::is_same_v<Type, int32_t>, "Only int16_t and int32_t can be byte-swapped");
+    Type raw;
+};
+
+/**
+ * IEEE 754 binary16 sample.
+ */
+struct Half {
+    uint16_t bits;
+};
+
+/**
+ * Maps a sample type to the soxr-native type it is converted to and from. `uint8_t` is unsigned 8-bit PCM with an offset of 128,
+ * as in 8-bit WAV files.
+ */
+template <typename Type>
+struct SampleFormat {
+    // The soxr-native types need no conversion
+    using Native = Type;
+};
+template <>
+struct SampleFormat<Int24> {
+    using Native = int32_t;
+};
+template <>
+struct SampleFormat<uint8_t> {
+    using Native = int16_t;
+};
+template <typename Type>
+struct SampleFormat<ByteSwapped<Type>> {
+    using Native = Type;
+};
+template <>
+struct SampleFormat<Half> {
+    using Native = float;
+};
+
+namespace detail {
+
+// Conversion kernels, each converting `n` samples from `src` to `dst`. The vector paths are chosen at compile time from the target's
+// instruction set; build with -mavx2 -mf16c (or -march=native) to enable all of them.
+
+inline void convert(const Int24* src, int32_t* dst, size_t n) noexcept {
+    const uint8_t* bytes = src->bytes;
+    size_t i = 0;
+#if defined(__AVX2__)
+    // Each lane expands 4 packed samples into the top 3 bytes of 4 int32s. The 32-byte load reads 8 bytes past the 8 samples, so stop
+    // while at least 11 samples remain.
+    const __m256i spread = _mm256_setr_epi32(0, 1, 2, 2, 3, 4, 5, 5);
+    const __m256i shuffle = _mm256_setr_epi8(-1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, //
+                                             -1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11);
+    for (; i + 11 <= n; i += 8) {
+        __m256i packed = _mm256_loadu_si256((const __m256i*)(bytes + 3 * i));
+        __m256i samples = _mm256_shuffle_epi8(_mm256_permutevar8x32_epi32(packed, spread), shuffle);
+        _mm256_storeu_si256((__m256i*)(dst + i), samples);
+    }
+#endif
+    for (; i < n; i++) {
+        const uint8_t* b = bytes + 3 * i;
+        dst[i] = (int32_t)((uint32_t)b[0] << 8 | (uint32_t)b[1] << 16 | (uint32_t)b[2] << 24);
+    }
+}
+
+inline void convert(const int32_t* src, Int24* dst, size_t n) noexcept {
+    uint8_t* bytes = dst->bytes;
+    size_t i = 0;
+#if defined(__AVX2__)
+    // Round to 24 bits, then pack the low 3 bytes of each int32 into 24 contiguous bytes
+    const __m256i max = _mm256_set1_epi32(0x7fffff);
+    const __m256i one = _mm256_set1_epi32(1);
+    const __m256i shuffle = _mm256_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1, //
+                                             0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    const __m256i gather = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 7, 7);
+    for (; i + 8 <= n; i += 8) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)(src + i));
+        __m256i rounded = _mm256_add_epi32(_mm256_srai_epi32(x, 8), _mm256_and_si256(_mm256_srli_epi32(x, 7), one));
+        __m256i packed = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(_mm256_min_epi32(rounded, max), shuffle), gather);
+        _mm_storeu_si128((__m128i*)(bytes + 3 * i), _mm256_castsi256_si128(packed));
+        _mm_storel_epi64((__m128i*)(bytes + 3 * i + 16), _mm256_extracti128_si256(packed, 1));
+    }
+#endif
+    for (; i < n; i++) {
+        int32_t rounded = std::min((src[i] >> 8) + ((src[i] >> 7) & 1), 0x7fffff);
+        uint8_t* b = bytes + 3 * i;
+        b[0] = (uint8_t)rounded;
+        b[1] = (uint8_t)(rounded >> 8);
+        b[2] = (uint8_t)(rounded >> 16);
+    }
+}
+
+inline void convert(const uint8_t* src, int16_t* dst, size_t n) noexcept {
+    size_t i = 0;
+#if defined(__SSE2__)
+    // Flipping the top bit makes the samples signed; unpacking them into the high byte scales them to 16 bits
+    const __m128i offset = _mm_set1_epi8((char)0x80);
+    for (; i + 16 <= n; i += 16) {
+        __m128i x = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(src + i)), offset);
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_unpacklo_epi8(_mm_setzero_si128(), x));
+        _mm_storeu_si128((__m128i*)(dst + i + 8), _mm_unpackhi_epi8(_mm_setzero_si128(), x));
+    }
+#endif
+    for (; i < n; i++) {
+        dst[i] = (int16_t)(((int)src[i] - 128) << 8);
+    }
+}
+
+inline void convert(const int16_t* src, uint8_t* dst, size_t n) noexcept {
+    size_t i = 0;
+#if defined(__SSE2__)
+    const __m128i half = _mm_set1_epi16(0x80);
+    const __m128i offset = _mm_set1_epi8((char)0x80);
+    for (; i + 16 <= n; i += 16) {
+        __m128i lo = _mm_srai_epi16(_mm_adds_epi16(_mm_loadu_si128((const __m128i*)(src + i)), half), 8);
+        __m128i hi = _mm_srai_epi16(_mm_adds_epi16(_mm_loadu_si128((const __m128i*)(src + i + 8)), half), 8);
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_xor_si128(_mm_packs_epi16(lo, hi), offset));
+    }
+#endif
+    for (; i < n; i++) {
+        dst[i] = (uint8_t)(std::min(((int)src[i] + 128) >> 8, 127) + 128);
+    }
+}
+
+inline void convert(const ByteSwapped<int16_t>* src, int16_t* dst, size_t n) noexcept {
+    static_assert(sizeof(ByteSwapped<int16_t>) == sizeof(int16_t));
+    size_t i = 0;
+#if defined(__AVX2__)
+    for (; i + 16 <= n; i += 16) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)(src + i));
+        _mm256_storeu_si256((__m256i*)(dst + i), _mm256_or_si256(_mm256_slli_epi16(x, 8), _mm256_srli_epi16(x, 8)));
+    }
+#elif defined(__SSE2__)
+    for (; i + 8 <= n; i += 8) {
+        __m128i x = _mm_loadu_si128((const __m128i*)(src + i));
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_or_si128(_mm_slli_epi16(x, 8), _mm_srli_epi16(x, 8)));
+    }
+#endif
+    for (; i < n; i++) {
+        uint16_t x = (uint16_t)src[i].raw;
+        dst[i] = (int16_t)(uint16_t)(x << 8 | x >> 8);
+    }
+}
+
+inline void convert(const int16_t* src, ByteSwapped<int16_t>* dst, size_t n) noexcept {
+    // Swapping is its own inverse
+    convert(reinterpret_cast<const ByteSwapped<int16_t>*>(src), reinterpret_cast<int16_t*>(dst), n);
+}
+
+inline void convert(const ByteSwapped<int32_t>* src, int32_t* dst, size_t n) noexcept {
+    static_assert(sizeof(ByteSwapped<int32_t>) == sizeof(int32_t));
+    size_t i = 0;
+#if defined(__AVX2__)
+    const __m256i reverse = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12, //
+                                             3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+    for (; i + 8 <= n; i += 8) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)(src + i));
+        _mm256_storeu_si256((__m256i*)(dst + i), _mm256_shuffle_epi8(x, reverse));
+    }
+#elif defined(__SSE2__)
+    // Without a byte shuffle, swap the 16-bit halves and then the bytes within each half
+    for (; i + 4 <= n; i += 4) {
+        __m128i x = _mm_loadu_si128((const __m128i*)(src + i));
+        x = _mm_shufflehi_epi16(_mm_shufflelo_epi16(x, 0xb1), 0xb1);
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_or_si128(_mm_slli_epi16(x, 8), _mm_srli_epi16(x, 8)));
+    }
+#endif
+    for (; i < n; i++) {
+        uint32_t x = (uint32_t)src[i].raw;
+        dst[i] = (int32_t)(x << 24 | (x << 8 & 0xff0000) | (x >> 8 & 0xff00) | x >> 24);
+    }
+}
+
+inline void convert(const int32_t* src, ByteSwapped<int32_t>* dst, size_t n) noexcept {
+    convert(reinterpret_cast<const ByteSwapped<int32_t>*>(src), reinterpret_cast<int32_t*>(dst), n);
+}
+
+inline void convert(const Half* src, float* dst, size_t n) noexcept {
+    size_t i = 0;
+#if defined(__F16C__)
+    for (; i + 8 <= n; i += 8) {
+        _mm256_storeu_ps(dst + i, _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)(src + i))));
+    }
+#endif
+    for (; i < n; i++) {
+        uint32_t sign = (uint32_t)(src[i].bits & 0x8000) << 16;
+        uint32_t exponent = src[i].bits >> 10 & 0x1f;
+        uint32_t mantissa = src[i].bits & 0x3ff;
+        if (exponent == 0) {
+            // Zero or subnormal
+            float magnitude = std::ldexp((float)mantissa, -24);
+            dst[i] = sign ? -magnitude : magnitude;
+        } else if (exponent == 0x1f) {
+            dst[i] = std::bit_cast<float>(sign | 0x7f800000 | mantissa << 13);
+        } else {
+            dst[i] = std::bit_cast<float>(sign | (exponent + 112) << 23 | mantissa << 13);
+        }
+    }
+}
+
+inline void convert(const float* src, Half* dst, size_t n) noexcept {
+    size_t i = 0;
+#if defined(__F16C__)
+    for (; i + 8 <= n; i += 8) {
+        _mm_storeu_si128((__m128i*)(dst + i), _mm256_cvtps_ph(_mm256_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT));
+    }
+#endif
+    for (; i < n; i++) {
+        uint32_t x = std::bit_cast<uint32_t>(src[i]);
+        uint16_t sign = (uint16_t)(x >> 16 & 0x8000);
+        x &= 0x7fffffff;
+        if (x >= 0x7f800000) {
+            // Infinity, or NaN kept quiet
+            dst[i].bits = sign | 0x7c00 | (x > 0x7f800000 ? 0x200 : 0);
+        } else if (x >= 0x477ff000) {
+            // Rounds to more than the largest half
+            dst[i].bits = sign | 0x7c00;
+        } else if (x < 0x38800000) {
+            // Subnormal, rounded to nearest even by the default rounding mode
+            dst[i].bits = sign | (uint16_t)std::nearbyint(std::bit_cast<float>(x) * 0x1p24f);
+        } else {
+            // Rebias the exponent and round the mantissa to nearest even
+            dst[i].bits = sign | (uint16_t)((x - 0x38000000 + 0xfff + (x >> 13 & 1)) >> 13);
+        }
+    }
+}
+
+} // namespace detail
+
+/**
+ * Stream resampler for sample types that soxr doesn't support natively, such as `Int24`, `uint8_t`, `ByteSwapped<int16_t>` and
+ * `Half`. Input is converted to its `SampleFormat::Native` type one block at a time just before it is handed to soxr, and output is
+ * converted back right after, so no more than one block is ever staged. The conversion buffers are allocated once. Native types
+ * pass through without any staging, so this is also usable with just one side converted.
+ */
+template <typename InputType,
+          typename OutputType,
+          SoxrDataShape InputShape = SoxrDataShape::Interleaved,
+          SoxrDataShape OutputShape = SoxrDataShape::Interleaved>
+class FormatResampler {
+  private:
+    using RawInputType = std::remove_const_t<InputType>;
+    using InputNative = typename SampleFormat<RawInputType>::Native;
+    using OutputNative = typename SampleFormat<OutputType>::Native;
+    static constexpr bool convert_input = !std::is_same_v<RawInputType, InputNative>;
+    static constexpr bool convert_output = !std::is_same_v<OutputType, OutputNative>;
+    static constexpr bool input_interleaved = InputShape == SoxrDataShape::Interleaved;
+    static constexpr bool output_interleaved = OutputShape == SoxrDataShape::Interleaved;
+
+  public:
+    using Resampler =
+        SoxResampler<std::conditional_t<convert_input, const InputNative, InputType>, OutputNative, InputShape, OutputShape>;
+    using IoSpec = SoxrIoSpec<std::conditional_t<convert_input, const InputNative, InputType>, InputShape, OutputNative, OutputShape>;
+
+  private:
+    Resampler m_resampler;
+    size_t m_block_frames;
+    // Staging blocks, laid out like the data they hold; split channels are m_block_frames apart
+    std::vector<InputNative> m_input_block;
+    std::vector<OutputNative> m_output_block;
+
+    // Converts `frames` frames of `buf` starting at `offset` into `block`, or the other way around
+    template <typename From, typename To, bool Interleaved, size_t Channels, size_t Extent>
+    void convert_block(const SoxrBuffer<From, Channels, Extent>& buf, To* block, size_t offset, size_t frames) const noexcept {
+        const unsigned int num_channels = m_resampler.num_channels();
+        if constexpr (Interleaved) {
+            detail::convert(buf.channel(0) + offset * num_channels, block, frames * num_channels);
+        } else {
+            for (size_t c = 0; c < num_channels; c++) {
+                detail::convert(buf.channel(c) + offset, block + c * m_block_frames, frames);
+            }
+        }
+    }
+
+    template <typename From, typename To, bool Interleaved, size_t Channels, size_t Extent>
+    void convert_block(const From* block, const SoxrBuffer<To, Channels, Extent>& buf, size_t offset, size_t frames) const noexcept {
+        const unsigned int num_channels = m_resampler.num_channels();
+        if constexpr (Interleaved) {
+            detail::convert(block, buf.channel(0) + offset * num_channels, frames * num_channels);
+        } else {
+            for (size_t c = 0; c < num_channels; c++) {
+                detail::convert(block + c * m_block_frames, buf.channel(c) + offset, frames);
+            }
+        }
+    }
+
+    // View of the staging block holding `frames` frames, shaped like a caller's buffer with `Channels` channel pointers
+    template <size_t Channels, typename Type, bool Interleaved>
+    SoxrBuffer<Type, Channels> block_buffer(Type* block, size_t frames) const {
+        std::array<Type*, Channels> ptrs{};
+        for (size_t c = 0; c < (Interleaved ? 1 : std::min<size_t>(m_resampler.num_channels(), Channels)); c++) {
+            ptrs[c] = block + c * m_block_frames;
+        }
+        return SoxrBuffer<Type, Channels>(ptrs, Interleaved ? frames * m_resampler.num_channels() : frames);
+    }
+
+  public:
+    /**
+     * Creates a stream resampler with format conversion.
+     * @param input_rate sample rate of the input
+     * @param output_rate target sample rate of the resampled output
+     * @param num_channels channel count
+     * @param block_frames number of frames converted at a time
+     * @param io_spec input/output configuration, in terms of the native types
+     * @param quality_spec resampling quality configuration
+     * @param runtime_spec runtime configuration
+     */
+    FormatResampler(double input_rate,
+                    double output_rate,
+                    unsigned int num_channels,
+                    size_t block_frames = 1024,
+                    const IoSpec& io_spec = IoSpec(),
+                    const SoxrQualitySpec& quality_spec = SoxrQualitySpec(SoxrQualityRecipe::High, 0),
+                    const SoxrRuntimeSpec& runtime_spec = SoxrRuntimeSpec(1))
+        : m_resampler(input_rate, output_rate, num_channels, io_spec, quality_spec, runtime_spec)
+        , m_block_frames(block_frames) //
+    {
+        if constexpr (convert_input) {
+            m_input_block.resize(block_frames * num_channels);
+        }
+        if constexpr (convert_output) {
+            m_output_block.resize(block_frames * num_channels);
+        }
+    }
+
+    /**
+     * Resamples data from the provided input buffer into the provided output buffer, converting formats on the way. Same contract as
+     * `SoxResampler::process`.
+     * @param ibuf readonly buffer to input samples
+     * @param obuf buffer to write output samples
+     * @param done true if there are no input samples and no more will be available
+     * @return The pair (`ilen`, `olen`) describing the number of samples read and written respectively.
+     */
+    template <size_t InputChannels,
+              size_t OutputChannels,
+              size_t InputExtent = std::dynamic_extent,
+              size_t OutputExtent = std::dynamic_extent>
+    std::pair<size_t, size_t> process(const SoxrBuffer<InputType, InputChannels, InputExtent>& ibuf,
+                                      SoxrBuffer<OutputType, OutputChannels, OutputExtent>& obuf,
+                                      bool done = false) {
+        static_assert(!input_interleaved || InputChannels == 1, "Input buffer has invalid shape");
+        static_assert(!output_interleaved || OutputChannels == 1, "Output buffer has invalid shape");
+        const unsigned int num_channels = m_resampler.num_channels();
+        const size_t ilen = done ? 0 : ibuf.size(input_interleaved, num_channels);
+        const size_t olen = obuf.size(output_interleaved, num_channels);
+
+        size_t idone = 0, odone = 0;
+        while (odone < olen && (done || idone < ilen)) {
+            size_t in_frames = std::min(m_block_frames, ilen - idone);
+            size_t out_frames = std::min(m_block_frames, olen - odone);
+            auto block_ibuf = [&] {
+                if constexpr (convert_input) {
+                    convert_block<InputType, InputNative, input_interleaved>(ibuf, m_input_block.data(), idone, in_frames);
+                    return block_buffer<InputChannels, const InputNative, input_interleaved>(m_input_block.data(), in_frames);
+                } else {
+                    return ibuf.advance(idone, input_interleaved, num_channels).truncate(in_frames, input_interleaved, num_channels);
+                }
+            }();
+            auto block_obuf = [&] {
+                if constexpr (convert_output) {
+                    return block_buffer<OutputChannels, OutputNative, output_interleaved>(m_output_block.data(), out_frames);
+                } else {
+                    return obuf.advance(odone, output_interleaved, num_channels)
+                        .truncate(out_frames, output_interleaved, num_channels);
+                }
+            }();
+            auto [i, o] = m_resampler.process(block_ibuf, block_obuf, done);
+            if constexpr (convert_output) {
+                convert_block<OutputNative, OutputType, output_interleaved>(m_output_block.data(), obuf, odone, o);
+            }
+            idone += i;
+            odone += o;
+            if (i == 0 && o == 0) {
+                break;
+            }
+        }
+
+        return std::make_pair(idone, odone);
+    }
+
+    /**
+     * Access the underlying resampler, for example to query its delay or clear it.
+     */
+    Resampler& resampler() noexcept {
+        return m_resampler;
+    }
+};
+
+} // namespace soxrpp
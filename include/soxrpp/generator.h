@@ -0,0 +1,207 @@
+#pragma once
+
+#include "soxrpp.h"
+
+#include <coroutine>
+#include <exception>
+#include <iterator>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace soxrpp {
+
+/**
+ * Lazy sequence of resampled blocks, produced by a coroutine one block at a time as the caller iterates. Each block is an interleaved
+ * span of samples that stays valid until the generator has produced as many further blocks as the buffer policy allows. Move-only;
+ * iterate it once with a range-based for loop.
+ */
+template <typename Type>
+class BlockGenerator {
+  public:
+    struct promise_type {
+        std::span<const Type> block;
+        std::exception_ptr error;
+
+        BlockGenerator get_return_object() noexcept {
+            return BlockGenerator(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+
+        // Nothing is resampled until the first block is asked for
+        std::suspend_always initial_suspend() noexcept {
+            return {};
+        }
+
+        std::suspend_always final_suspend() noexcept {
+            return {};
+        }
+
+        std::suspend_always yield_value(std::span<const Type> value) noexcept {
+            block = value;
+            return {};
+        }
+
+        void return_void() noexcept {}
+
+        void unhandled_exception() noexcept {
+            error = std::current_exception();
+        }
+    };
+
+    class iterator {
+      private:
+        std::coroutine_handle<promise_type> m_handle;
+
+      public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = std::span<const Type>;
+        using difference_type = std::ptrdiff_t;
+
+        iterator() noexcept = default;
+
+        explicit iterator(std::coroutine_handle<promise_type> handle) noexcept
+            : m_handle(handle) {}
+
+        const std::span<const Type>& operator*() const noexcept {
+            return m_handle.promise().block;
+        }
+
+        iterator& operator++() {
+            resume(m_handle);
+            return *this;
+        }
+
+        void operator++(int) {
+            ++*this;
+        }
+
+        bool operator==(std::default_sentinel_t) const noexcept {
+            return !m_handle || m_handle.done();
+        }
+    };
+
+  private:
+    std::coroutine_handle<promise_type> m_handle;
+
+    explicit BlockGenerator(std::coroutine_handle<promise_type> handle) noexcept
+        : m_handle(handle) {}
+
+    // Runs the coroutine up to its next block and rethrows anything it threw, such as a `SoxrError`
+    static void resume(std::coroutine_handle<promise_type> handle) {
+        handle.resume();
+        if (handle.promise().error) {
+            std::rethrow_exception(std::exchange(handle.promise().error, nullptr));
+        }
+    }
+
+  public:
+    BlockGenerator(BlockGenerator&& other) noexcept
+        : m_handle(std::exchange(other.m_handle, nullptr)) {}
+
+    BlockGenerator& operator=(BlockGenerator&& other) noexcept {
+        if (this != &other) {
+            if (m_handle) {
+                m_handle.destroy();
+            }
+            m_handle = std::exchange(other.m_handle, nullptr);
+        }
+        return *this;
+    }
+
+    ~BlockGenerator() {
+        if (m_handle) {
+            m_handle.destroy();
+        }
+    }
+
+    /**
+     * Produces the first block. May only be called once.
+     */
+    iterator begin() {
+        resume(m_handle);
+        return iterator(m_handle);
+    }
+
+    std::default_sentinel_t end() const noexcept {
+        return std::default_sentinel;
+    }
+};
+
+namespace detail {
+
+// Cycles through the blocks of `storage`, or of `owned` if `storage` is empty, filling each with output()
+template <typename InputType, typename OutputType, SoxrDataShape InputShape, typename Instrumentation>
+BlockGenerator<OutputType> generate_blocks(
+    SoxResampler<InputType, OutputType, InputShape, SoxrDataShape::Interleaved, Instrumentation>& resampler,
+    size_t block_frames,
+    std::vector<OutputType> owned,
+    std::span<OutputType> storage) {
+    if (storage.empty()) {
+        storage = owned;
+    }
+    const size_t block_size = block_frames * resampler.num_channels();
+    const size_t num_buffers = storage.size() / block_size;
+    for (size_t i = 0;; i = (i + 1) % num_buffers) {
+        std::span<OutputType> block = storage.subspan(i * block_size, block_size);
+        size_t filled = 0;
+        while (filled < block_size) {
+            size_t odone = resampler.output(SoxrBuffer<OutputType>(block.data() + filled, block_size - filled));
+            if (odone == 0) {
+                break;
+            }
+            filled += odone * resampler.num_channels();
+        }
+        if (filled > 0) {
+            co_yield std::span<const OutputType>(block.data(), filled);
+        }
+        // The input provider ran dry, so the stream is over
+        if (filled < block_size) {
+            co_return;
+        }
+    }
+}
+
+} // namespace detail
+
+/**
+ * Exposes the output of a resampler as a lazy generator of interleaved blocks of `block_frames` frames, for pipelining resampling
+ * with other stages on one thread. Input is pulled from the provider configured with `set_input_fn` or `set_input_range` only as
+ * blocks are asked for. Every block is full except possibly the last one, which ends the sequence when the input provider runs dry.
+ * The generator cycles through `num_buffers` blocks that are allocated once, so a block stays valid until `num_buffers - 1` more
+ * blocks have been produced: use 1 when each block is consumed before asking for the next, and more to keep earlier blocks alive
+ * while later stages catch up. The resampler must outlive the generator.
+ * @param resampler resampler with a configured input provider
+ * @param block_frames number of frames per block
+ * @param num_buffers number of blocks to cycle through
+ */
+template <typename InputType, typename OutputType, SoxrDataShape InputShape, typename Instrumentation>
+BlockGenerator<OutputType> output_blocks(
+    SoxResampler<InputType, OutputType, InputShape, SoxrDataShape::Interleaved, Instrumentation>& resampler,
+    size_t block_frames,
+    size_t num_buffers = 1) {
+    if (block_frames == 0 || num_buffers == 0) {
+        throw SoxrError("Blocks must hold at least one frame");
+    }
+    std::vector<OutputType> owned(block_frames * resampler.num_channels() * num_buffers);
+    return detail::generate_blocks(resampler, block_frames, std::move(owned), {});
+}
+
+/**
+ * Like the other overload, but cycles through blocks of caller-supplied `storage` instead of allocating any, for example to reuse
+ * the same memory across many streams. `storage` holds as many blocks as fit in it and must outlive the generator.
+ * @param resampler resampler with a configured input provider
+ * @param block_frames number of frames per block
+ * @param storage memory for at least one block of interleaved samples
+ */
+template <typename InputType, typename OutputType, SoxrDataShape InputShape, typename Instrumentation>
+BlockGenerator<OutputType> output_blocks(
+    SoxResampler<InputType, OutputType, InputShape, SoxrDataShape::Interleaved, Instrumentation>& resampler,
+    size_t block_frames,
+    std::span<OutputType> storage) {
+    if (block_frames == 0 || storage.size() < block_frames * resampler.num_channels()) {
+        throw SoxrError("Storage must hold at least one block");
+    }
+    return detail::generate_blocks(resampler, block_frames, {}, storage);
+}
+
+} // namespace soxrpp
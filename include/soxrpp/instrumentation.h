@@ -0,0 +1,239 @@
+#pragma once
+
+#include "soxrpp.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+
+namespace soxrpp {
+
+/**
+ * Plain copy of the values in a `ResamplerMetrics` at one point in time.
+ */
+struct ResamplerMetricsSnapshot {
+    // Calls taking less than 2^i ns, and at least 2^(i - 1) ns, are counted in bucket i; the last bucket also counts anything slower
+    static constexpr size_t num_buckets = 40;
+
+    uint64_t process_calls;   // Calls to process()
+    uint64_t output_calls;    // Calls to output()
+    uint64_t input_fn_calls;  // Calls to the input provider from output()
+    uint64_t input_frames;    // Frames read by process() or returned by the input provider
+    uint64_t output_frames;   // Frames written by process() or output()
+    uint64_t process_ns;      // Time spent in process()
+    uint64_t output_ns;       // Time spent in output(), including the input provider
+    uint64_t input_fn_ns;     // Time spent in the input provider
+    uint64_t clips;           // Samples that clipped
+    double delay;             // Most recently reported delay, in output frames
+    double max_delay;         // Largest reported delay, in output frames
+    std::array<uint64_t, num_buckets> latency; // Histogram of process() and output() call times
+
+    /**
+     * Query the upper bound of latency bucket `i`, in nanoseconds.
+     */
+    static constexpr uint64_t bucket_bound_ns(size_t i) noexcept {
+        return uint64_t(1) << i;
+    }
+
+    /**
+     * Estimate a latency percentile from the histogram, as the upper bound of the bucket that contains it.
+     * @param p percentile in [0, 1], for example 0.99
+     * @return The latency in nanoseconds, or 0 if no calls were recorded.
+     */
+    uint64_t latency_percentile_ns(double p) const noexcept {
+        uint64_t total = 0;
+        for (uint64_t count : latency) {
+            total += count;
+        }
+        if (total == 0) {
+            return 0;
+        }
+        uint64_t target = std::max<uint64_t>(1, (uint64_t)(p * total + .5));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < num_buckets; i++) {
+            seen += latency[i];
+            if (seen >= target) {
+                return bucket_bound_ns(i);
+            }
+        }
+        return bucket_bound_ns(num_buckets - 1);
+    }
+
+    /**
+     * Export the scalar metrics by calling `fn(name, value)` once for each of them, for forwarding to a metrics system. Latency
+     * percentiles are included as `latency_p50_ns`, `latency_p99_ns` and `latency_max_ns`; use `latency` for the full histogram.
+     * @param fn callable `void(*)(const char* name, double value)`
+     */
+    template <typename Fn>
+    void for_each(Fn&& fn) const {
+        fn("process_calls", (double)process_calls);
+        fn("output_calls", (double)output_calls);
+        fn("input_fn_calls", (double)input_fn_calls);
+        fn("input_frames", (double)input_frames);
+        fn("output_frames", (double)output_frames);
+        fn("process_ns", (double)process_ns);
+        fn("output_ns", (double)output_ns);
+        fn("input_fn_ns", (double)input_fn_ns);
+        fn("clips", (double)clips);
+        fn("delay", delay);
+        fn("max_delay", max_delay);
+        fn("latency_p50_ns", (double)latency_percentile_ns(0.5));
+        fn("latency_p99_ns", (double)latency_percentile_ns(0.99));
+        fn("latency_max_ns", (double)latency_percentile_ns(1));
+    }
+};
+
+/**
+ * Lock-free counters filled in by `AtomicInstrumentation`. May be shared by several resamplers to aggregate them, and read from any
+ * thread while they run.
+ */
+class ResamplerMetrics {
+  private:
+    std::atomic<uint64_t> m_process_calls{0};
+    std::atomic<uint64_t> m_output_calls{0};
+    std::atomic<uint64_t> m_input_fn_calls{0};
+    std::atomic<uint64_t> m_input_frames{0};
+    std::atomic<uint64_t> m_output_frames{0};
+    std::atomic<uint64_t> m_process_ns{0};
+    std::atomic<uint64_t> m_output_ns{0};
+    std::atomic<uint64_t> m_input_fn_ns{0};
+    std::atomic<uint64_t> m_clips{0};
+    std::atomic<double> m_delay{0};
+    std::atomic<double> m_max_delay{0};
+    std::array<std::atomic<uint64_t>, ResamplerMetricsSnapshot::num_buckets> m_latency{};
+
+    static uint64_t count(std::chrono::nanoseconds elapsed) noexcept {
+        return (uint64_t)std::max<std::chrono::nanoseconds::rep>(0, elapsed.count());
+    }
+
+    void record_call(std::chrono::nanoseconds elapsed, uint64_t clips, double delay) noexcept {
+        size_t bucket = std::min<size_t>(std::bit_width(count(elapsed)), ResamplerMetricsSnapshot::num_buckets - 1);
+        m_latency[bucket].fetch_add(1, std::memory_order_relaxed);
+        m_clips.fetch_add(clips, std::memory_order_relaxed);
+        m_delay.store(delay, std::memory_order_relaxed);
+        double max_delay = m_max_delay.load(std::memory_order_relaxed);
+        while (delay > max_delay && !m_max_delay.compare_exchange_weak(max_delay, delay, std::memory_order_relaxed)) {
+        }
+    }
+
+  public:
+    void record_process(size_t idone, size_t odone, std::chrono::nanoseconds elapsed, uint64_t new_clips, double delay) noexcept {
+        m_process_calls.fetch_add(1, std::memory_order_relaxed);
+        m_input_frames.fetch_add(idone, std::memory_order_relaxed);
+        m_output_frames.fetch_add(odone, std::memory_order_relaxed);
+        m_process_ns.fetch_add(count(elapsed), std::memory_order_relaxed);
+        record_call(elapsed, new_clips, delay);
+    }
+
+    void record_output(size_t odone, std::chrono::nanoseconds elapsed, uint64_t new_clips, double delay) noexcept {
+        m_output_calls.fetch_add(1, std::memory_order_relaxed);
+        m_output_frames.fetch_add(odone, std::memory_order_relaxed);
+        m_output_ns.fetch_add(count(elapsed), std::memory_order_relaxed);
+        record_call(elapsed, new_clips, delay);
+    }
+
+    void record_input_fn(size_t ilen, std::chrono::nanoseconds elapsed) noexcept {
+        m_input_fn_calls.fetch_add(1, std::memory_order_relaxed);
+        m_input_frames.fetch_add(ilen, std::memory_order_relaxed);
+        m_input_fn_ns.fetch_add(count(elapsed), std::memory_order_relaxed);
+    }
+
+    /**
+     * Copy the current values. Each value is read atomically, but the snapshot as a whole is not, so values may be mutually
+     * inconsistent by the calls that are in flight while it is taken.
+     */
+    ResamplerMetricsSnapshot snapshot() const noexcept {
+        ResamplerMetricsSnapshot result{
+            .process_calls = m_process_calls.load(std::memory_order_relaxed),
+            .output_calls = m_output_calls.load(std::memory_order_relaxed),
+            .input_fn_calls = m_input_fn_calls.load(std::memory_order_relaxed),
+            .input_frames = m_input_frames.load(std::memory_order_relaxed),
+            .output_frames = m_output_frames.load(std::memory_order_relaxed),
+            .process_ns = m_process_ns.load(std::memory_order_relaxed),
+            .output_ns = m_output_ns.load(std::memory_order_relaxed),
+            .input_fn_ns = m_input_fn_ns.load(std::memory_order_relaxed),
+            .clips = m_clips.load(std::memory_order_relaxed),
+            .delay = m_delay.load(std::memory_order_relaxed),
+            .max_delay = m_max_delay.load(std::memory_order_relaxed),
+            .latency = {},
+        };
+        for (size_t i = 0; i < ResamplerMetricsSnapshot::num_buckets; i++) {
+            result.latency[i] = m_latency[i].load(std::memory_order_relaxed);
+        }
+        return result;
+    }
+};
+
+/**
+ * Instrumentation policy for `SoxResampler` that counts calls, frames, time and clips, and keeps a latency histogram, in a
+ * `ResamplerMetrics` object. Costs two clock reads and a handful of relaxed atomic adds per call.
+ */
+class AtomicInstrumentation {
+  private:
+    std::shared_ptr<ResamplerMetrics> m_metrics;
+    // soxr reports a running clip count per resampler, but the metrics may be shared, so only the increase is forwarded
+    size_t m_clips{0};
+
+    uint64_t new_clips(size_t clips) noexcept {
+        // The count starts over when the resampler is cleared
+        uint64_t result = clips >= m_clips ? clips - m_clips : clips;
+        m_clips = clips;
+        return result;
+    }
+
+  public:
+    static constexpr bool enabled = true;
+
+    /**
+     * Records into a new `ResamplerMetrics` object.
+     */
+    AtomicInstrumentation()
+        : m_metrics(std::make_shared<ResamplerMetrics>()) {}
+
+    /**
+     * Records into `metrics`, which may be shared with other resamplers.
+     */
+    explicit AtomicInstrumentation(std::shared_ptr<ResamplerMetrics> metrics)
+        : m_metrics(std::move(metrics)) {}
+
+    void record_process(size_t idone, size_t odone, std::chrono::nanoseconds elapsed, size_t clips, double delay) noexcept {
+        m_metrics->record_process(idone, odone, elapsed, new_clips(clips), delay);
+    }
+
+    void record_output(size_t odone, std::chrono::nanoseconds elapsed, size_t clips, double delay) noexcept {
+        m_metrics->record_output(odone, elapsed, new_clips(clips), delay);
+    }
+
+    void record_input_fn(size_t ilen, std::chrono::nanoseconds elapsed) noexcept {
+        m_metrics->record_input_fn(ilen, elapsed);
+    }
+
+    /**
+     * Access the metrics object, for example to hand it to a thread that scrapes it.
+     */
+    const std::shared_ptr<ResamplerMetrics>& metrics() const noexcept {
+        return m_metrics;
+    }
+
+    /**
+     * Copy the current values of the metrics.
+     */
+    ResamplerMetricsSnapshot snapshot() const noexcept {
+        return m_metrics->snapshot();
+    }
+};
+
+/**
+ * Stream resampler that records its activity with `AtomicInstrumentation`. Read the metrics with `instrumentation().snapshot()`.
+ */
+template <typename InputType = float,
+          typename OutputType = float,
+          SoxrDataShape InputShape = SoxrDataShape::Interleaved,
+          SoxrDataShape OutputShape = SoxrDataShape::Interleaved>
+using InstrumentedSoxResampler = SoxResampler<InputType, OutputType, InputShape, OutputShape, AtomicInstrumentation>;
+
+} // namespace soxrpp
@@ -0,0 +1,413 @@
+#pragma once
+
+#include "soxrpp.h"
+#include "soxrpp/parallel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <numeric>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+namespace soxrpp {
+
+namespace detail {
+
+// Appends trivially copyable values to a snapshot blob in native byte order, which is fine for restoring on the same build
+class BlobWriter {
+  private:
+    std::vector<std::byte>& m_blob;
+
+  public:
+    explicit BlobWriter(std::vector<std::byte>& blob)
+        : m_blob(blob) {}
+
+    template <typename Type>
+    void put(const Type* values, size_t count) {
+        const size_t offset = m_blob.size();
+        m_blob.resize(offset + count * sizeof(Type));
+        if (count > 0) {
+            std::memcpy(m_blob.data() + offset, values, count * sizeof(Type));
+        }
+    }
+
+    template <typename Type>
+    void put(const Type& value) {
+        put(&value, 1);
+    }
+};
+
+class BlobReader {
+  private:
+    std::span<const std::byte> m_blob;
+
+  public:
+    explicit BlobReader(std::span<const std::byte> blob)
+        : m_blob(blob) {}
+
+    template <typename Type>
+    void get(Type* values, size_t count) {
+        if (count > m_blob.size() / sizeof(Type)) {
+            throw SoxrError("Truncated stream snapshot");
+        }
+        if (count > 0) {
+            std::memcpy(values, m_blob.data(), count * sizeof(Type));
+        }
+        m_blob = m_blob.subspan(count * sizeof(Type));
+    }
+
+    template <typename Type>
+    Type get() {
+        Type value;
+        get(&value, 1);
+        return value;
+    }
+};
+
+} // namespace detail
+
+/**
+ * Stream resampler whose state can be captured with `snapshot` and carried on with `restore` in another process, for moving live
+ * streams between workers without a gap. soxr keeps its state private, so rather than copying it, the resampler records the last
+ * stretch of input it consumed, enough to cover its filter plus one period of the rate ratio. A restore replays that stretch through
+ * a fresh soxr instance, starting on a period boundary so that its output samples fall at exactly the same instants as the
+ * original's, and discards the output the original had already delivered. The restored stream therefore continues sample-aligned
+ * and without a discontinuity, matching the original to within the filter's precision rather than bit for bit, since the replayed
+ * filter starts from silence a full filter length before the samples it is asked for.
+ *
+ * Rates must be whole numbers so that the ratio has a period, and variable-rate resampling isn't supported, since the replay
+ * couldn't reproduce the ratio's history. The filter must be linear-phase, whose transient after a replay starts stays within the
+ * warm-up; minimum- and intermediate-phase ones are rejected. Interleaved data only.
+ */
+template <typename InputType = float, typename OutputType = float>
+class MigratableResampler {
+    static_assert(!std::is_const_v<OutputType>, "OutputType cannot be const");
+
+  private:
+    using RawInputType = std::remove_const_t<InputType>;
+
+  public:
+    using Resampler = SoxResampler<const RawInputType, OutputType>;
+    using IoSpec = SoxrIoSpec<const RawInputType, SoxrDataShape::Interleaved, OutputType, SoxrDataShape::Interleaved>;
+
+  private:
+    static constexpr uint32_t snapshot_magic = 0x53525853; // "SXRS"
+    static constexpr uint32_t snapshot_version = 1;
+    // Input frames fed per chunk when replaying, and the largest period a rate pair may have
+    static constexpr size_t replay_chunk = 1024;
+    static constexpr uint64_t max_period = 1 << 20;
+
+    double m_input_rate;
+    double m_output_rate;
+    unsigned int m_num_channels;
+    IoSpec m_io_spec;
+    SoxrQualitySpec m_quality_spec;
+    Resampler m_resampler;
+    // Input frames per period of the ratio, and the output frames they make
+    uint64_t m_period_in{0};
+    uint64_t m_period_out{0};
+    // Input frames replayed ahead of the first output owed, so the filter is warm by then
+    size_t m_warmup{0};
+    // Most recent input frames, frame f at f % m_tail_frames
+    size_t m_tail_frames{0};
+    std::vector<RawInputType> m_tail;
+    uint64_t m_consumed{0};
+    uint64_t m_produced{0};
+    // Output a restore resampled ahead of the original, delivered before anything else
+    std::vector<OutputType> m_pending;
+    size_t m_pending_head{0};
+    // Output a restore fell short of the original by, dropped from the next outputs
+    uint64_t m_drop{0};
+    bool m_done{false};
+
+    size_t pending_frames() const noexcept {
+        return m_pending.size() / m_num_channels - m_pending_head;
+    }
+
+    void record(const RawInputType* input, size_t frames) noexcept {
+        const size_t skip = frames > m_tail_frames ? frames - m_tail_frames : 0;
+        for (size_t i = skip; i < frames; i++) {
+            const size_t slot = (m_consumed + i) % m_tail_frames;
+            std::copy_n(input + i * m_num_channels, m_num_channels, m_tail.data() + slot * m_num_channels);
+        }
+    }
+
+    // First input frame to replay for output frame `owed` onward: a period boundary a full warm-up before the input that frame
+    // depends on. Throws if it has already dropped out of the recorded tail, which means soxr had fallen further behind its input
+    // than it does when given enough room for its output
+    uint64_t replay_start(uint64_t owed) const {
+        const uint64_t owed_input = owed * m_period_in / m_period_out;
+        const uint64_t start = owed_input > m_warmup ? (owed_input - m_warmup) / m_period_in * m_period_in : 0;
+        if (start + m_tail_frames < m_consumed) {
+            throw SoxrError("The stream is too far behind its input to be migrated");
+        }
+        return start;
+    }
+
+    // Feeds input to soxr on behalf of a restore, keeping only output the original hadn't delivered yet
+    void replay(const RawInputType* input, size_t frames, uint64_t output_index) {
+        std::vector<OutputType> scratch((output_frames(replay_chunk, m_input_rate, m_output_rate) + 64) * m_num_channels);
+        size_t consumed = 0;
+        while (true) {
+            SoxrBuffer<const RawInputType> ibuf(input + consumed * m_num_channels, (frames - consumed) * m_num_channels);
+            SoxrBuffer<OutputType> obuf(scratch.data(), scratch.size());
+            auto [idone, odone] = m_resampler.process(ibuf, obuf);
+            consumed += idone;
+            const size_t keep_from = output_index >= m_produced ? 0 : (size_t)std::min<uint64_t>(odone, m_produced - output_index);
+            m_pending.insert(m_pending.end(), scratch.begin() + keep_from * m_num_channels, scratch.begin() + odone * m_num_channels);
+            output_index += odone;
+            if (consumed == frames && odone * m_num_channels < scratch.size()) {
+                break;
+            }
+        }
+        m_drop = output_index < m_produced ? m_produced - output_index : 0;
+    }
+
+  public:
+    /**
+     * Creates a migratable stream resampler.
+     * @param input_rate sample rate of the input, a whole number
+     * @param output_rate target sample rate of the resampled output, a whole number
+     * @param num_channels channel count
+     * @param io_spec input/output configuration
+     * @param quality_spec resampling quality configuration, linear-phase and without `SoxrQualityFlags::VariableRate`
+     * @param runtime_spec runtime configuration
+     */
+    MigratableResampler(double input_rate,
+                        double output_rate,
+                        unsigned int num_channels,
+                        const IoSpec& io_spec = IoSpec(),
+                        const SoxrQualitySpec& quality_spec = SoxrQualitySpec(SoxrQualityRecipe::High, 0),
+                        const SoxrRuntimeSpec& runtime_spec = SoxrRuntimeSpec(1))
+        : m_input_rate(input_rate)
+        , m_output_rate(output_rate)
+        , m_num_channels(num_channels)
+        , m_io_spec(io_spec)
+        , m_quality_spec(quality_spec)
+        , m_resampler(input_rate, output_rate, num_channels, io_spec, quality_spec, runtime_spec) //
+    {
+        if (input_rate < 1 || output_rate < 1 || input_rate != std::floor(input_rate) || output_rate != std::floor(output_rate)) {
+            throw SoxrError("Migratable streams need whole-number sample rates");
+        }
+        if (quality_spec.flags & SoxrQualityFlags::VariableRate) {
+            throw SoxrError("Migratable streams can't be variable-rate");
+        }
+        if (quality_spec.phase_response != 50) {
+            throw SoxrError("Migratable streams need a linear-phase filter");
+        }
+        const uint64_t divisor = std::gcd((uint64_t)input_rate, (uint64_t)output_rate);
+        m_period_in = (uint64_t)input_rate / divisor;
+        m_period_out = (uint64_t)output_rate / divisor;
+        if (m_period_in > max_period) {
+            throw SoxrError("The rate ratio's period is too long for a migratable stream");
+        }
+        // The tail also covers input soxr has taken but not resampled yet, which is within another warm-up
+        m_warmup = detail::filter_warmup(input_rate, output_rate, quality_spec, runtime_spec);
+        m_tail_frames = 2 * m_warmup + (size_t)m_period_in;
+        m_tail.resize(m_tail_frames * num_channels);
+    }
+
+    /**
+     * Resamples data from the provided input buffer into the provided output buffer. Same contract as `SoxResampler::process`.
+     * @param ibuf readonly buffer of interleaved input frames
+     * @param obuf buffer to write interleaved output frames
+     * @param done true if there are no input samples and no more will be available
+     * @return The pair (`ilen`, `olen`) describing the number of frames read and written respectively.
+     */
+    template <size_t InputExtent = std::dynamic_extent, size_t OutputExtent = std::dynamic_extent>
+    std::pair<size_t, size_t> process(const SoxrBuffer<InputType, 1, InputExtent>& ibuf,
+                                      SoxrBuffer<OutputType, 1, OutputExtent>& obuf,
+                                      bool done = false) {
+        const size_t capacity = obuf.size(true, m_num_channels);
+        OutputType* dst = obuf.channel(0);
+        const size_t delivered = std::min(pending_frames(), capacity);
+        std::copy_n(m_pending.data() + m_pending_head * m_num_channels, delivered * m_num_channels, dst);
+        m_pending_head += delivered;
+        if (pending_frames() == 0) {
+            m_pending.clear();
+            m_pending_head = 0;
+        }
+        if (delivered == capacity) {
+            m_produced += delivered;
+            return std::make_pair((size_t)0, delivered);
+        }
+
+        SoxrBuffer<const RawInputType> input(ibuf.channel(0), ibuf.size(true, m_num_channels) * m_num_channels);
+        SoxrBuffer<OutputType> output(dst + delivered * m_num_channels, (capacity - delivered) * m_num_channels);
+        auto [idone, odone] = m_resampler.process(input, output, done);
+        if (!done) {
+            record(ibuf.channel(0), idone);
+            m_consumed += idone;
+        }
+        m_done = m_done || done;
+        if (m_drop > 0) {
+            const size_t dropped = (size_t)std::min<uint64_t>(m_drop, odone);
+            OutputType* fresh = dst + delivered * m_num_channels;
+            std::memmove(fresh, fresh + dropped * m_num_channels, (odone - dropped) * m_num_channels * sizeof(OutputType));
+            odone -= dropped;
+            m_drop -= dropped;
+        }
+        m_produced += delivered + odone;
+        return std::make_pair(idone, delivered + odone);
+    }
+
+    /**
+     * Capture the stream's state as a binary blob for `restore`, which has to run on the same build of the library. Holds the
+     * configuration, the recent input and the position of the stream, so it is a few times the filter length in size. Throws a
+     * `SoxrError` once the stream has been flushed with `done`.
+     */
+    std::vector<std::byte> snapshot() {
+        if (m_done) {
+            throw SoxrError("A flushed stream can't be migrated");
+        }
+        replay_start(m_produced + pending_frames());
+        const uint64_t tail = std::min<uint64_t>(m_consumed, m_tail_frames);
+        const uint64_t pending = pending_frames();
+        std::vector<std::byte> blob;
+        detail::BlobWriter writer(blob);
+        writer.put(snapshot_magic);
+        writer.put(snapshot_version);
+        writer.put((uint32_t)sizeof(RawInputType));
+        writer.put((uint32_t)sizeof(OutputType));
+        writer.put((uint32_t)m_num_channels);
+        writer.put(m_input_rate);
+        writer.put(m_output_rate);
+        writer.put(m_io_spec.scale);
+        writer.put((uint64_t)m_io_spec.flags);
+        writer.put(m_quality_spec.precision);
+        writer.put(m_quality_spec.phase_response);
+        writer.put(m_quality_spec.passband_end);
+        writer.put(m_quality_spec.stopband_begin);
+        writer.put((uint64_t)m_quality_spec.flags);
+        writer.put(m_consumed);
+        writer.put(m_produced);
+        writer.put((uint64_t)*m_resampler.num_clips());
+        writer.put(tail);
+        writer.put(pending);
+        // The tail wraps around the ring at most once
+        for (uint64_t f = m_consumed - tail; f < m_consumed; f++) {
+            writer.put(m_tail.data() + (f % m_tail_frames) * m_num_channels, m_num_channels);
+        }
+        writer.put(m_pending.data() + m_pending_head * m_num_channels, pending * m_num_channels);
+        return blob;
+    }
+
+    /**
+     * Continue a stream captured by `snapshot`, possibly in another process. Throws a `SoxrError` if the blob is malformed or was
+     * made by a resampler with different sample types.
+     * @param blob result of `snapshot`
+     * @param runtime_spec runtime configuration for this host
+     */
+    static MigratableResampler restore(std::span<const std::byte> blob, const SoxrRuntimeSpec& runtime_spec = SoxrRuntimeSpec(1)) {
+        detail::BlobReader reader(blob);
+        if (reader.get<uint32_t>() != snapshot_magic || reader.get<uint32_t>() != snapshot_version) {
+            throw SoxrError("Not a stream snapshot from this version");
+        }
+        if (reader.get<uint32_t>() != sizeof(RawInputType) || reader.get<uint32_t>() != sizeof(OutputType)) {
+            throw SoxrError("Stream snapshot has different sample types");
+        }
+        const unsigned int num_channels = reader.get<uint32_t>();
+        const double input_rate = reader.get<double>();
+        const double output_rate = reader.get<double>();
+        IoSpec io_spec;
+        io_spec.scale = reader.get<double>();
+        io_spec.flags = (unsigned long)reader.get<uint64_t>();
+        SoxrQualitySpec quality_spec;
+        quality_spec.precision = reader.get<double>();
+        quality_spec.phase_response = reader.get<double>();
+        quality_spec.passband_end = reader.get<double>();
+        quality_spec.stopband_begin = reader.get<double>();
+        quality_spec.flags = (unsigned long)reader.get<uint64_t>();
+        MigratableResampler resampler(input_rate, output_rate, num_channels, io_spec, quality_spec, runtime_spec);
+
+        const uint64_t consumed = reader.get<uint64_t>();
+        const uint64_t produced = reader.get<uint64_t>();
+        const uint64_t clips = reader.get<uint64_t>();
+        const uint64_t tail = reader.get<uint64_t>();
+        const uint64_t pending = reader.get<uint64_t>();
+        if (tail != std::min<uint64_t>(consumed, resampler.m_tail_frames)) {
+            throw SoxrError("Stream snapshot doesn't match this build");
+        }
+        std::vector<RawInputType> input(tail * num_channels);
+        reader.get(input.data(), input.size());
+        std::vector<OutputType> ahead(pending * num_channels);
+        reader.get(ahead.data(), ahead.size());
+
+        // The output owed from soxr starts after what was delivered and what was already resampled ahead
+        resampler.m_consumed = consumed;
+        const uint64_t start = resampler.replay_start(produced + pending);
+        const size_t offset = (size_t)(start - (consumed - tail));
+        resampler.m_produced = produced + pending;
+        resampler.replay(input.data() + offset * num_channels,
+                         (size_t)(consumed - start),
+                         start / resampler.m_period_in * resampler.m_period_out);
+        resampler.m_pending.insert(resampler.m_pending.begin(), ahead.begin(), ahead.end());
+        resampler.m_produced = produced;
+        resampler.m_consumed = consumed - tail;
+        resampler.record(input.data(), (size_t)tail);
+        resampler.m_consumed = consumed;
+        *resampler.m_resampler.num_clips() = (size_t)clips;
+        return resampler;
+    }
+
+    /**
+     * Query the current delay of the resampler, in output frames, including output resampled ahead by a restore.
+     */
+    double delay() noexcept {
+        return m_resampler.delay() + (double)pending_frames() - (double)m_drop;
+    }
+
+    /**
+     * Query the number of input frames consumed since the stream started, across migrations.
+     */
+    uint64_t frames_consumed() const noexcept {
+        return m_consumed;
+    }
+
+    /**
+     * Query the number of output frames produced since the stream started, across migrations.
+     */
+    uint64_t frames_produced() const noexcept {
+        return m_produced;
+    }
+
+    /**
+     * Access the underlying resampler.
+     */
+    Resampler& resampler() noexcept {
+        return m_resampler;
+    }
+
+    /**
+     * Query the name of the resampling engine.
+     */
+    char const* engine() noexcept {
+        return m_resampler.engine();
+    }
+
+    /**
+     * Query the channel count.
+     */
+    unsigned int num_channels() const noexcept {
+        return m_num_channels;
+    }
+
+    /**
+     * Prepare to process a fresh signal with the same config.
+     */
+    void clear() {
+        m_resampler.clear();
+        m_consumed = 0;
+        m_produced = 0;
+        m_pending.clear();
+        m_pending_head = 0;
+        m_drop = 0;
+        m_done = false;
+    }
+};
+
+} // namespace soxrpp
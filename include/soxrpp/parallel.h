@@ -0,0 +1,397 @@
+#pragma once
+
+#include "soxrpp.h"
+#include "soxrpp/thread_pool.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <memory>
+#include <numeric>
+#include <utility>
+#include <vector>
+
+namespace soxrpp {
+
+namespace detail {
+
+// Splits `num_channels` channels into at most `num_groups` contiguous groups of nearly equal size, as (first, count) pairs
+inline std::vector<std::pair<size_t, size_t>> channel_groups(unsigned int num_channels, size_t num_groups) {
+    num_groups = std::clamp<size_t>(num_groups, 1, std::max(1u, num_channels));
+    std::vector<std::pair<size_t, size_t>> groups;
+    size_t first = 0;
+    for (size_t g = 0; g < num_groups; g++) {
+        size_t count = num_channels / num_groups + (g < num_channels % num_groups ? 1 : 0);
+        groups.emplace_back(first, count);
+        first += count;
+    }
+    return groups;
+}
+
+// Every group is fed the same number of samples with the same configuration, so they must agree on how much they read and wrote
+inline std::pair<size_t, size_t> merge_group_results(const std::vector<std::pair<size_t, size_t>>& results) {
+    for (const auto& result : results) {
+        if (result != results.front()) {
+            throw SoxrError("Channel groups produced different output lengths");
+        }
+    }
+    return results.front();
+}
+
+// Owns `frames` samples for each of `num_channels` channels in the given shape and views them as a SoxrBuffer
+template <typename Type, SoxrDataShape Shape, size_t Channels>
+class ScratchBuffer {
+  private:
+    static constexpr bool interleaved = Shape == SoxrDataShape::Interleaved;
+    std::vector<Type> m_samples;
+    size_t m_frames;
+    unsigned int m_num_channels;
+
+  public:
+    ScratchBuffer(size_t frames, unsigned int num_channels)
+        : m_samples(frames * num_channels)
+        , m_frames(frames)
+        , m_num_channels(num_channels) {}
+
+    SoxrBuffer<Type, Channels> buffer() {
+        std::array<Type*, Channels> ptrs{};
+        for (size_t c = 0; c < (interleaved ? 1 : std::min<size_t>(m_num_channels, Channels)); c++) {
+            ptrs[c] = m_samples.data() + c * m_frames;
+        }
+        return SoxrBuffer<Type, Channels>(ptrs, interleaved ? m_frames * m_num_channels : m_frames);
+    }
+
+    // Copies `frames` samples per channel starting at frame `from` of this buffer to frame `to` of `dst`
+    template <size_t Extent>
+    void copy_to(const SoxrBuffer<Type, Channels, Extent>& dst, size_t from, size_t to, size_t frames) const {
+        if constexpr (interleaved) {
+            std::copy_n(m_samples.data() + from * m_num_channels, frames * m_num_channels, dst.channel(0) + to * m_num_channels);
+        } else {
+            for (size_t c = 0; c < m_num_channels; c++) {
+                std::copy_n(m_samples.data() + c * m_frames + from, frames, dst.channel(c) + to);
+            }
+        }
+    }
+};
+
+// Input frames of history a resampler needs before the first output frame it is trusted with, and of lookahead after the last one,
+// for resampling a signal in pieces that match a single pass. soxr doesn't report its filter length, but the delay of a linear-phase
+// filter settles at half of it, so the length is taken from the delay of the spec's linear-phase twin, which has the same length.
+// A linear-phase filter reaches half its length either way and a minimum- or intermediate-phase one up to its whole length, and
+// both get twice that as a margin.
+inline size_t filter_warmup(double input_rate,
+                            double output_rate,
+                            const SoxrQualitySpec& quality_spec,
+                            const SoxrRuntimeSpec& runtime_spec = SoxrRuntimeSpec(1)) {
+    SoxrQualitySpec linear = quality_spec;
+    linear.phase_response = 50;
+    linear.flags &= ~SoxrQualityFlags::VariableRate;
+    using IoSpec = SoxrIoSpec<const float, SoxrDataShape::Interleaved, float, SoxrDataShape::Interleaved>;
+    SoxResampler<const float, float> probe(input_rate, output_rate, 1, IoSpec(), linear, runtime_spec);
+
+    // Feed silence until the delay has stopped growing, which takes a little over one filter length
+    constexpr size_t block = 1 << 12;
+    std::vector<float> silence(block);
+    std::vector<float> output(output_frames(block, input_rate, output_rate) + 64);
+    SoxrBuffer<const float> ibuf(silence.data(), silence.size());
+    SoxrBuffer<float> obuf(output.data(), output.size());
+    double delay = 0;
+    for (size_t fed = 0; fed < std::max<size_t>(1 << 15, (size_t)std::ceil(4 * delay * input_rate / output_rate)); fed += block) {
+        probe.process(ibuf, obuf);
+        delay = std::max(delay, probe.delay());
+    }
+    const double length = 2 * delay * input_rate / output_rate;
+    return std::max<size_t>(64, (size_t)std::ceil(quality_spec.phase_response == 50 ? length : 2 * length));
+}
+
+} // namespace detail
+
+/**
+ * Stream resampler for split multichannel data that resamples groups of channels on separate threads. Channels are independent, so
+ * each group gets its own `SoxResampler` and all groups run in parallel on an internal `ThreadPool`. Use it like a `SoxResampler`
+ * with split input and output; the set_input_fn API is not supported.
+ */
+template <typename InputType = float, typename OutputType = float>
+class ParallelSoxResampler {
+  private:
+    using Resampler = SoxResampler<InputType, OutputType, SoxrDataShape::Split, SoxrDataShape::Split>;
+
+    unsigned int m_num_channels;
+    std::vector<std::pair<size_t, size_t>> m_groups;
+    std::vector<Resampler> m_resamplers;
+    std::unique_ptr<ThreadPool> m_pool;
+
+  public:
+    /**
+     * Creates a parallel stream resampler.
+     * @param input_rate sample rate of the input
+     * @param output_rate target sample rate of the resampled output
+     * @param num_channels channel count
+     * @param io_spec input/output configuration
+     * @param quality_spec resampling quality configuration
+     * @param runtime_spec runtime configuration, applied to every channel group
+     * @param num_threads number of threads, and therefore channel groups, to use; 0 uses one per core
+     */
+    ParallelSoxResampler(double input_rate,
+                         double output_rate,
+                         unsigned int num_channels,
+                         const SoxrIoSpec<InputType, SoxrDataShape::Split, OutputType, SoxrDataShape::Split>& io_spec =
+                             SoxrIoSpec<InputType, SoxrDataShape::Split, OutputType, SoxrDataShape::Split>(),
+                         const SoxrQualitySpec& quality_spec = SoxrQualitySpec(SoxrQualityRecipe::High, 0),
+                         const SoxrRuntimeSpec& runtime_spec = SoxrRuntimeSpec(1),
+                         unsigned int num_threads = 0)
+        : m_num_channels(num_channels)
+        , m_pool(std::make_unique<ThreadPool>(num_threads)) //
+    {
+        m_groups = detail::channel_groups(num_channels, m_pool->size());
+        m_resamplers.reserve(m_groups.size());
+        for (auto [first, count] : m_groups) {
+            m_resamplers.emplace_back(input_rate, output_rate, count, io_spec, quality_spec, runtime_spec);
+        }
+    }
+
+    /**
+     * Resamples data from the provided input buffer into the provided output buffer, one channel group per thread. See
+     * `SoxResampler::process`.
+     * @param ibuf readonly split buffer to input samples
+     * @param obuf split buffer to write output samples
+     * @param done true if there are no input samples and no more will be available
+     * @return The pair (`ilen`, `olen`) describing the number of samples read and written respectively.
+     */
+    template <size_t InputChannels,
+              size_t OutputChannels,
+              size_t InputExtent = std::dynamic_extent,
+              size_t OutputExtent = std::dynamic_extent>
+    std::pair<size_t, size_t> process(const SoxrBuffer<InputType, InputChannels, InputExtent>& ibuf,
+                                      SoxrBuffer<OutputType, OutputChannels, OutputExtent>& obuf,
+                                      bool done = false) {
+        if (m_num_channels > InputChannels || m_num_channels > OutputChannels) {
+            throw SoxrError("Buffer has fewer channels than the resampler");
+        }
+        std::vector<std::pair<size_t, size_t>> results(m_groups.size());
+        m_pool->parallel_for(m_groups.size(), [&](size_t g) {
+            auto [first, count] = m_groups[g];
+            auto group_ibuf = ibuf.channel_range(first, count);
+            auto group_obuf = obuf.channel_range(first, count);
+            results[g] = m_resamplers[g].process(group_ibuf, group_obuf, done);
+        });
+        return detail::merge_group_results(results);
+    }
+
+    /**
+     * Query the total number of samples that clipped when resampling, across all channel groups. Only valid for integer data types.
+     */
+    size_t num_clips() noexcept {
+        size_t clips = 0;
+        for (Resampler& resampler : m_resamplers) {
+            clips += *resampler.num_clips();
+        }
+        return clips;
+    }
+
+    /**
+     * Query the current delay of the resampler, in output samples.
+     */
+    double delay() noexcept {
+        return m_resamplers.front().delay();
+    }
+
+    /**
+     * Query the name of the resampling engine.
+     */
+    char const* engine() noexcept {
+        return m_resamplers.front().engine();
+    }
+
+    /**
+     * Query the number of channel groups, which is also the number of threads used.
+     */
+    size_t num_groups() const noexcept {
+        return m_groups.size();
+    }
+
+    /**
+     * Prepare to process a fresh signal with the same config.
+     */
+    void clear() {
+        for (Resampler& resampler : m_resamplers) {
+            resampler.clear();
+        }
+    }
+};
+
+/**
+ * Resample a split multichannel signal held entirely in memory, running groups of channels in parallel on `pool`. Behaves like
+ * `oneshot` with split input and output.
+ * @param pool threads to run the channel groups on; one group is made per thread
+ * @param input_rate sample rate of the input
+ * @param output_rate target sample rate of the resampled output
+ * @param num_channels channel count
+ * @param ibuf split buffer containing input samples
+ * @param obuf split buffer to write output samples
+ * @param io_spec input/output configuration
+ * @param quality_spec resampling quality configuration
+ * @param runtime_spec runtime configuration, applied to every channel group
+ */
+template <size_t InputChannels,
+          size_t OutputChannels,
+          typename InputType,
+          typename OutputType,
+          size_t InputExtent,
+          size_t OutputExtent>
+inline std::pair<size_t, size_t> parallel_oneshot(ThreadPool& pool,
+                                                  double input_rate,
+                                                  double output_rate,
+                                                  unsigned int num_channels,
+                                                  const SoxrBuffer<InputType, InputChannels, InputExtent>& ibuf,
+                                                  SoxrBuffer<OutputType, OutputChannels, OutputExtent>& obuf,
+                                                  const SoxrIoSpec<InputType, SoxrDataShape::Split, OutputType, SoxrDataShape::Split>&
+                                                      io_spec = SoxrIoSpec<InputType, SoxrDataShape::Split, OutputType, SoxrDataShape::Split>(),
+                                                  const SoxrQualitySpec& quality_spec = SoxrQualitySpec(SoxrQualityRecipe::Low, 0),
+                                                  const SoxrRuntimeSpec& runtime_spec = SoxrRuntimeSpec(1)) {
+    if (num_channels > InputChannels || num_channels > OutputChannels) {
+        throw SoxrError("Buffer has fewer channels than the resampler");
+    }
+    auto groups = detail::channel_groups(num_channels, pool.size());
+    std::vector<std::pair<size_t, size_t>> results(groups.size());
+    pool.parallel_for(groups.size(), [&](size_t g) {
+        auto [first, count] = groups[g];
+        auto group_ibuf = ibuf.channel_range(first, count);
+        auto group_obuf = obuf.channel_range(first, count);
+        results[g] = oneshot(input_rate, output_rate, count, group_ibuf, group_obuf, io_spec, quality_spec, runtime_spec);
+    });
+    return detail::merge_group_results(results);
+}
+
+/**
+ * Resample a split multichannel signal held entirely in memory, running groups of channels in parallel on a temporary thread pool.
+ * Prefer the overload that takes a `ThreadPool` when calling this repeatedly.
+ * @param input_rate sample rate of the input
+ * @param output_rate target sample rate of the resampled output
+ * @param num_channels channel count
+ * @param ibuf split buffer containing input samples
+ * @param obuf split buffer to write output samples
+ * @param io_spec input/output configuration
+ * @param quality_spec resampling quality configuration
+ * @param runtime_spec runtime configuration, applied to every channel group
+ * @param num_threads number of threads, and therefore channel groups, to use; 0 uses one per core
+ */
+template <size_t InputChannels,
+          size_t OutputChannels,
+          typename InputType,
+          typename OutputType,
+          size_t InputExtent,
+          size_t OutputExtent>
+inline std::pair<size_t, size_t> parallel_oneshot(double input_rate,
+                                                  double output_rate,
+                                                  unsigned int num_channels,
+                                                  const SoxrBuffer<InputType, InputChannels, InputExtent>& ibuf,
+                                                  SoxrBuffer<OutputType, OutputChannels, OutputExtent>& obuf,
+                                                  const SoxrIoSpec<InputType, SoxrDataShape::Split, OutputType, SoxrDataShape::Split>&
+                                                      io_spec = SoxrIoSpec<InputType, SoxrDataShape::Split, OutputType, SoxrDataShape::Split>(),
+                                                  const SoxrQualitySpec& quality_spec = SoxrQualitySpec(SoxrQualityRecipe::Low, 0),
+                                                  const SoxrRuntimeSpec& runtime_spec = SoxrRuntimeSpec(1),
+                                                  unsigned int num_threads = 0) {
+    ThreadPool pool(num_threads);
+    return parallel_oneshot(pool, input_rate, output_rate, num_channels, ibuf, obuf, io_spec, quality_spec, runtime_spec);
+}
+
+/**
+ * Resample a long signal held entirely in memory by cutting it into overlapping time segments and resampling the segments in
+ * parallel on `pool`, each with its own resampler. Each segment starts `warmup` input samples early so that its filter history is
+ * the same as in a single pass, and the warm-up output is trimmed before the segments are stitched together. The result therefore
+ * matches `oneshot` up to rounding noise below the requested precision (about -120 dBFS for `High`). Takes the same arguments as
+ * `oneshot` and falls back to it when the input is too short to split, the rates aren't whole numbers, or variable-rate resampling
+ * is requested.
+ * @param pool threads to resample the segments on; one segment is made per thread
+ * @param input_rate sample rate of the input
+ * @param output_rate target sample rate of the resampled output
+ * @param num_channels channel count
+ * @param ibuf buffer containing input samples
+ * @param obuf buffer to write output samples
+ * @param io_spec input/output configuration
+ * @param quality_spec resampling quality configuration
+ * @param runtime_spec runtime configuration, applied to every segment
+ * @param warmup number of input samples of overlap between segments; 0 derives it from the filter length, for any phase response
+ */
+template <size_t InputChannels,
+          size_t OutputChannels,
+          typename InputType = float,
+          typename OutputType = float,
+          size_t InputExtent = std::dynamic_extent,
+          size_t OutputExtent = std::dynamic_extent,
+          SoxrDataShape InputShape = SoxrDataShape::Interleaved,
+          SoxrDataShape OutputShape = SoxrDataShape::Interleaved>
+inline std::pair<size_t, size_t> segmented_oneshot(ThreadPool& pool,
+                                                   double input_rate,
+                                                   double output_rate,
+                                                   unsigned int num_channels,
+                                                   const SoxrBuffer<InputType, InputChannels, InputExtent>& ibuf,
+                                                   SoxrBuffer<OutputType, OutputChannels, OutputExtent>& obuf,
+                                                   const SoxrIoSpec<InputType, InputShape, OutputType, OutputShape>& io_spec =
+                                                       SoxrIoSpec<InputType, InputShape, OutputType, OutputShape>(),
+                                                   const SoxrQualitySpec& quality_spec = SoxrQualitySpec(SoxrQualityRecipe::Low, 0),
+                                                   const SoxrRuntimeSpec& runtime_spec = SoxrRuntimeSpec(1),
+                                                   size_t warmup = 0) {
+    constexpr bool input_interleaved = InputShape == SoxrDataShape::Interleaved;
+    constexpr bool output_interleaved = OutputShape == SoxrDataShape::Interleaved;
+    const size_t ilen = ibuf.size(input_interleaved, num_channels);
+
+    // Segments can only be stitched seamlessly if every segment starts on an input sample that lines up with an output sample,
+    // which needs a rational ratio with a reasonably short period
+    if (pool.size() < 2 || std::floor(input_rate) != input_rate || std::floor(output_rate) != output_rate ||
+        (quality_spec.flags & SoxrQualityFlags::VariableRate)) {
+        return oneshot(input_rate, output_rate, num_channels, ibuf, obuf, io_spec, quality_spec, runtime_spec);
+    }
+    const size_t divisor = std::gcd((size_t)input_rate, (size_t)output_rate);
+    // One period is `period_in` input samples and exactly `period_out` output samples
+    const size_t period_in = (size_t)input_rate / divisor;
+    const size_t period_out = (size_t)output_rate / divisor;
+
+    if (warmup == 0) {
+        warmup = detail::filter_warmup(input_rate, output_rate, quality_spec, runtime_spec);
+    }
+    const size_t warmup_periods = (warmup + period_in - 1) / period_in;
+    const size_t total_out = std::min(obuf.size(output_interleaved, num_channels), output_frames(ilen, input_rate, output_rate));
+    const size_t periods = total_out / period_out;
+    // Keep segments long compared to their overlap so that the warm-up doesn't dominate
+    const size_t num_segments = std::min(pool.size(), periods / (4 * warmup_periods + 1));
+    if (num_segments < 2) {
+        return oneshot(input_rate, output_rate, num_channels, ibuf, obuf, io_spec, quality_spec, runtime_spec);
+    }
+
+    // Segment boundaries in output samples; all but the last fall on period boundaries
+    std::vector<size_t> bounds(num_segments + 1);
+    for (size_t k = 0; k < num_segments; k++) {
+        bounds[k] = periods * k / num_segments * period_out;
+    }
+    bounds[num_segments] = total_out;
+
+    std::vector<size_t> produced(num_segments);
+    pool.parallel_for(num_segments, [&](size_t k) {
+        const size_t obegin = bounds[k];
+        const size_t oend = bounds[k + 1];
+        const size_t first_period = obegin / period_out;
+        const size_t ibegin = (first_period > warmup_periods ? first_period - warmup_periods : 0) * period_in;
+        const size_t iend = k + 1 == num_segments ? ilen : std::min(ilen, (oend / period_out + warmup_periods + 1) * period_in);
+        const size_t skip = obegin - ibegin / period_in * period_out;
+
+        auto segment_ibuf = ibuf.advance(ibegin, input_interleaved, num_channels).truncate(iend - ibegin, input_interleaved, num_channels);
+        detail::ScratchBuffer<OutputType, OutputShape, OutputChannels> scratch(
+            (size_t)((iend - ibegin) * output_rate / input_rate) + 2, num_channels);
+        auto segment_obuf = scratch.buffer();
+        auto [_, odone] = oneshot(input_rate, output_rate, num_channels, segment_ibuf, segment_obuf, io_spec, quality_spec, runtime_spec);
+
+        produced[k] = std::min(oend - obegin, odone > skip ? odone - skip : 0);
+        scratch.copy_to(obuf, skip, obegin, produced[k]);
+    });
+
+    for (size_t k = 0; k + 1 < num_segments; k++) {
+        if (produced[k] != bounds[k + 1] - bounds[k]) {
+            throw SoxrError("Segment produced less output than expected");
+        }
+    }
+    return std::make_pair(ilen, bounds[num_segments - 1] + produced.back());
+}
+
+} // namespace soxrpp
@@ -0,0 +1,586 @@
+#pragma once
+
+#include "soxrpp.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <numbers>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace soxrpp {
+
+namespace detail {
+
+#if defined(__AVX2__)
+constexpr const char* polyphase_engine_name = "soxrpp-polyphase-avx2";
+#elif defined(__SSE2__)
+constexpr const char* polyphase_engine_name = "soxrpp-polyphase-sse2";
+#else
+constexpr const char* polyphase_engine_name = "soxrpp-polyphase";
+#endif
+
+// Taps per phase are padded to a multiple of this, so the kernels below never need a tail loop
+constexpr size_t polyphase_tap_multiple = 8;
+
+// Dot product of `n` floats, with `n` a multiple of `polyphase_tap_multiple`
+inline float dot(const float* a, const float* b, size_t n) noexcept {
+#if defined(__AVX2__)
+    __m256 acc = _mm256_setzero_ps();
+    for (size_t i = 0; i < n; i += 8) {
+#if defined(__FMA__)
+        acc = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc);
+#else
+        acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+#endif
+    }
+    __m128 sum = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+#elif defined(__SSE2__)
+    // Two accumulators hide the latency of the adds
+    __m128 acc0 = _mm_setzero_ps();
+    __m128 acc1 = _mm_setzero_ps();
+    for (size_t i = 0; i < n; i += 8) {
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+    }
+    __m128 sum = _mm_add_ps(acc0, acc1);
+#endif
+#if defined(__SSE2__)
+    sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+    return _mm_cvtss_f32(sum);
+#else
+    float acc[polyphase_tap_multiple] = {};
+    for (size_t i = 0; i < n; i += polyphase_tap_multiple) {
+        for (size_t j = 0; j < polyphase_tap_multiple; j++) {
+            acc[j] += a[i + j] * b[i + j];
+        }
+    }
+    float sum = 0;
+    for (float x : acc) {
+        sum += x;
+    }
+    return sum;
+#endif
+}
+
+// Zeroth-order modified Bessel function of the first kind, for the Kaiser window
+inline double bessel_i0(double x) noexcept {
+    double sum = 1;
+    double term = 1;
+    for (int k = 1; k < 64 && term > sum * 1e-17; k++) {
+        term *= (x / (2 * k)) * (x / (2 * k));
+        sum += term;
+    }
+    return sum;
+}
+
+// Exact integer ratio between two rates, as the factor P in L/M = P/1 or 1/P, or 0 if there is none in [2, 4]
+inline unsigned int integer_factor(double a, double b) noexcept {
+    for (unsigned int factor = 2; factor <= 4; factor++) {
+        if (a == b * factor) {
+            return factor;
+        }
+    }
+    return 0;
+}
+
+} // namespace detail
+
+/**
+ * Immutable filter of a `PolyphaseResampler`: the phases of its Kaiser-windowed sinc low-pass and where its response is centered.
+ * Designing one takes a while and a long one takes a lot of memory, so resamplers with the same ratio, scale and quality share a
+ * single filter through `shared`, and each stream only keeps its own input history. Only this engine shares its filter: a
+ * `SoxResampler` still designs and owns its soxr filter and DFT state, which the pinned soxr keeps private to each `soxr_t`.
+ */
+struct PolyphaseFilter {
+    // Upsampling and downsampling factors; one of them is 1
+    int64_t up;
+    int64_t down;
+    // Output frames between the start of the filter's response and its center
+    int64_t skip;
+    // Phase p holds its taps reversed at taps[p * phase_taps], so they line up with ascending input samples
+    size_t phase_taps;
+    std::vector<float> taps;
+
+    /**
+     * Designs the filter for resampling between two rates that `PolyphaseResampler::supports`.
+     * @param input_rate sample rate of the input
+     * @param output_rate target sample rate of the resampled output
+     * @param scale gain applied to every output sample
+     * @param quality_spec resampling quality configuration; rolloff flags are ignored
+     */
+    static PolyphaseFilter design(double input_rate, double output_rate, double scale, const SoxrQualitySpec& quality_spec) {
+        PolyphaseFilter filter;
+        filter.up = std::max(1u, detail::integer_factor(output_rate, input_rate));
+        filter.down = std::max(1u, detail::integer_factor(input_rate, output_rate));
+        const int64_t factor = filter.up * filter.down;
+
+        // Kaiser design at the higher rate; the passband and stopband are fractions of the lower rate's Nyquist frequency
+        const double attenuation = std::max(21.0, 6.0206 * quality_spec.precision);
+        const double beta = attenuation > 50 ? 0.1102 * (attenuation - 8.7)
+                                             : 0.5842 * std::pow(attenuation - 21, 0.4) + 0.07886 * (attenuation - 21);
+        const double transition = std::numbers::pi * (quality_spec.stopband_begin - quality_spec.passband_end) / factor;
+        const double cutoff = (quality_spec.passband_end + quality_spec.stopband_begin) / 2 / factor;
+        const double order = (attenuation - 7.95) / (2.285 * transition);
+        // A half-length that is a multiple of the factor puts the center of the response on an output frame
+        const int64_t half = std::max<int64_t>(1, (int64_t)std::ceil(order / 2 / factor)) * factor;
+        filter.skip = half / filter.down;
+
+        std::vector<double> response(2 * half + 1);
+        double sum = 0;
+        for (int64_t j = -half; j <= half; j++) {
+            const double x = cutoff * j;
+            const double sinc = j == 0 ? 1 : std::sin(std::numbers::pi * x) / (std::numbers::pi * x);
+            const double r = (double)j / half;
+            const double window = detail::bessel_i0(beta * std::sqrt(std::max(0.0, 1 - r * r))) / detail::bessel_i0(beta);
+            response[j + half] = cutoff * sinc * window;
+            sum += response[j + half];
+        }
+
+        // Unity gain at DC for every phase, times the scale
+        const double gain = scale * filter.up / sum;
+        const size_t taps = (response.size() + filter.up - 1) / filter.up;
+        filter.phase_taps =
+            (taps + detail::polyphase_tap_multiple - 1) / detail::polyphase_tap_multiple * detail::polyphase_tap_multiple;
+        filter.taps.resize(filter.up * filter.phase_taps);
+        for (int64_t p = 0; p < filter.up; p++) {
+            for (size_t k = 0; k < filter.phase_taps; k++) {
+                const size_t j = p + k * filter.up;
+                filter.taps[p * filter.phase_taps + filter.phase_taps - 1 - k] =
+                    j < response.size() ? (float)(response[j] * gain) : 0.0f;
+            }
+        }
+        return filter;
+    }
+
+    /**
+     * Get the filter for this configuration, designing it only if no other resampler holds one already. Thread-safe; a filter is
+     * released once the last resampler using it is destroyed.
+     * @param input_rate sample rate of the input
+     * @param output_rate target sample rate of the resampled output
+     * @param scale gain applied to every output sample
+     * @param quality_spec resampling quality configuration; rolloff flags are ignored
+     */
+    static std::shared_ptr<const PolyphaseFilter> shared(double input_rate,
+                                                         double output_rate,
+                                                         double scale,
+                                                         const SoxrQualitySpec& quality_spec) {
+        using Key = std::tuple<unsigned int, unsigned int, double, double, double, double>;
+        static std::mutex mutex;
+        static std::map<Key, std::weak_ptr<const PolyphaseFilter>> cache;
+
+        const Key key(detail::integer_factor(output_rate, input_rate),
+                      detail::integer_factor(input_rate, output_rate),
+                      scale,
+                      quality_spec.precision,
+                      quality_spec.passband_end,
+                      quality_spec.stopband_begin);
+        std::lock_guard<std::mutex> lock(mutex);
+        if (auto it = cache.find(key); it != cache.end()) {
+            if (std::shared_ptr<const PolyphaseFilter> filter = it->second.lock()) {
+                return filter;
+            }
+        }
+        std::erase_if(cache, [](const auto& entry) {
+            return entry.second.expired();
+        });
+        auto filter = std::make_shared<const PolyphaseFilter>(design(input_rate, output_rate, scale, quality_spec));
+        cache[key] = filter;
+        return filter;
+    }
+};
+
+/**
+ * Built-in engine for the small integer ratios 2, 3 and 4, up or down, on float samples. A Kaiser-windowed sinc low-pass, designed
+ * from the passband, stopband and precision of a `SoxrQualitySpec`, is run directly as a polyphase FIR with SSE2 or AVX2 dot
+ * products. Unlike soxr's multi-stage DFT filters, every `process` call produces output as soon as the filter has the input for it,
+ * which keeps the per-call cost flat for small blocks. Output is aligned with the input and flushed the same way as soxr's, so it
+ * is a drop-in replacement for `SoxResampler::process` on the ratios it supports; use `supports` to check, or `AutoResampler` to
+ * pick an engine automatically. Resamplers with the same configuration share one `PolyphaseFilter`, so opening many streams costs
+ * one filter design and one set of taps.
+ */
+template <typename InputType = float,
+          typename OutputType = float,
+          SoxrDataShape InputShape = SoxrDataShape::Interleaved,
+          SoxrDataShape OutputShape = SoxrDataShape::Interleaved>
+class PolyphaseResampler {
+    static_assert(std::is_same_v<std::remove_const_t<InputType>, float> && std::is_same_v<OutputType, float>,
+                  "The polyphase engine only resamples float samples");
+
+  private:
+    static constexpr bool input_interleaved = InputShape == SoxrDataShape::Interleaved;
+    static constexpr bool output_interleaved = OutputShape == SoxrDataShape::Interleaved;
+
+    unsigned int m_num_channels;
+    std::shared_ptr<const PolyphaseFilter> m_filter;
+    // Copied out of the filter for the inner loops
+    int64_t m_up;
+    int64_t m_down;
+    int64_t m_skip;
+    size_t m_phase_taps;
+    const float* m_taps;
+
+    // Input history of each channel, m_capacity samples apart; sample 0 is input frame m_base
+    std::vector<float> m_history;
+    size_t m_capacity{0};
+    size_t m_length{0};
+    int64_t m_base{0};
+    // Input frames consumed, and index of the next output frame of the filter (which counts the m_skip frames never emitted)
+    int64_t m_consumed{0};
+    int64_t m_next{0};
+
+    // Newest input frame that output frame n depends on
+    int64_t newest_input(int64_t n) const noexcept {
+        return n * m_down / m_up;
+    }
+
+    // Drops history that no future output depends on, then makes room for `frames` more
+    void reserve(size_t frames) {
+        const int64_t keep_from = newest_input(m_next) - (int64_t)m_phase_taps + 1;
+        if (keep_from > m_base) {
+            const size_t drop = std::min<size_t>(keep_from - m_base, m_length);
+            for (unsigned int c = 0; c < m_num_channels; c++) {
+                float* channel = m_history.data() + c * m_capacity;
+                std::memmove(channel, channel + drop, (m_length - drop) * sizeof(float));
+            }
+            m_length -= drop;
+            m_base += drop;
+        }
+        if (m_length + frames > m_capacity) {
+            const size_t capacity = std::max(m_length + frames, 2 * m_capacity);
+            std::vector<float> history(capacity * m_num_channels);
+            for (unsigned int c = 0; c < m_num_channels; c++) {
+                std::copy_n(m_history.data() + c * m_capacity, m_length, history.data() + c * capacity);
+            }
+            m_history = std::move(history);
+            m_capacity = capacity;
+        }
+    }
+
+    void set_filter(std::shared_ptr<const PolyphaseFilter> filter) {
+        m_filter = std::move(filter);
+        m_up = m_filter->up;
+        m_down = m_filter->down;
+        m_skip = m_filter->skip;
+        m_phase_taps = m_filter->phase_taps;
+        m_taps = m_filter->taps.data();
+    }
+
+  public:
+    using IoSpec = SoxrIoSpec<InputType, InputShape, OutputType, OutputShape>;
+
+    /**
+     * Whether the engine can resample between these rates with this quality: the ratio must be exactly 2, 3 or 4 either way, and
+     * the quality spec must ask for a linear-phase, single-precision, fixed-rate filter that soxr wouldn't implement as a plain
+     * interpolator (so not `SoxrQualityRecipe::Quick`).
+     */
+    static bool supports(double input_rate, double output_rate, const SoxrQualitySpec& quality_spec) noexcept {
+        const bool ratio =
+            detail::integer_factor(input_rate, output_rate) != 0 || detail::integer_factor(output_rate, input_rate) != 0;
+        const bool filter = quality_spec.precision > 0 && quality_spec.precision <= 20 && quality_spec.phase_response == 50 &&
+                            quality_spec.stopband_begin > quality_spec.passband_end && quality_spec.passband_end > 0;
+        const bool flags = (quality_spec.flags & (SoxrQualityFlags::VariableRate | SoxrQualityFlags::DoublePrecision)) == 0;
+        return ratio && filter && flags;
+    }
+
+    /**
+     * Creates a resampler. Throws a `SoxrError` unless `supports(input_rate, output_rate, quality_spec)`.
+     * @param input_rate sample rate of the input
+     * @param output_rate target sample rate of the resampled output
+     * @param num_channels channel count
+     * @param io_spec input/output configuration; only the scale is used
+     * @param quality_spec resampling quality configuration; rolloff flags are ignored
+     */
+    PolyphaseResampler(double input_rate,
+                       double output_rate,
+                       unsigned int num_channels,
+                       const IoSpec& io_spec = IoSpec(),
+                       const SoxrQualitySpec& quality_spec = SoxrQualitySpec(SoxrQualityRecipe::High, 0))
+        : m_num_channels(num_channels) //
+    {
+        if (!supports(input_rate, output_rate, quality_spec)) {
+            throw SoxrError("The polyphase engine doesn't support this ratio or quality");
+        }
+        set_filter(PolyphaseFilter::shared(input_rate, output_rate, io_spec.scale, quality_spec));
+        clear();
+    }
+
+    /**
+     * Creates a resampler that runs a filter designed or shared elsewhere, such as one from `PolyphaseFilter::shared`.
+     * @param filter filter to run, which must not be null
+     * @param num_channels channel count
+     */
+    PolyphaseResampler(std::shared_ptr<const PolyphaseFilter> filter, unsigned int num_channels)
+        : m_num_channels(num_channels) //
+    {
+        set_filter(std::move(filter));
+        clear();
+    }
+
+    /**
+     * Resamples data from the provided input buffer into the provided output buffer. Same contract as `SoxResampler::process`: input
+     * is only consumed as far as there is room for its output, and once `done` is passed the filter is flushed until the output
+     * totals `output_frames` of the input.
+     * @param ibuf readonly buffer to input samples
+     * @param obuf buffer to write output samples
+     * @param done true if there are no input samples and no more will be available
+     * @return The pair (`ilen`, `olen`) describing the number of samples read and written respectively.
+     */
+    template <size_t InputChannels,
+              size_t OutputChannels,
+              size_t InputExtent = std::dynamic_extent,
+              size_t OutputExtent = std::dynamic_extent>
+    std::pair<size_t, size_t> process(const SoxrBuffer<InputType, InputChannels, InputExtent>& ibuf,
+                                      SoxrBuffer<OutputType, OutputChannels, OutputExtent>& obuf,
+                                      bool done = false) {
+        static_assert(!input_interleaved || InputChannels == 1, "Input buffer has invalid shape");
+        static_assert(!output_interleaved || OutputChannels == 1, "Output buffer has invalid shape");
+        const size_t ilen = done ? 0 : ibuf.size(input_interleaved, m_num_channels);
+        const int64_t olen = (int64_t)obuf.size(output_interleaved, m_num_channels);
+
+        // Take all of the input unless the output buffer fills up first, in which case take just what that output depends on
+        size_t idone = ilen;
+        const int64_t available = (((int64_t)(m_consumed + ilen)) * m_up + m_down - 1) / m_down;
+        if (available - m_next > olen) {
+            idone = (size_t)std::clamp<int64_t>(newest_input(m_next + olen - 1) + 1 - m_consumed, 0, ilen);
+        }
+
+        int64_t end;
+        size_t zeros = 0;
+        if (done) {
+            end = m_skip + (int64_t)((double)m_consumed * m_up / m_down + .5);
+            if (end > m_next) {
+                zeros = (size_t)std::max<int64_t>(0, newest_input(end - 1) + 1 - (m_base + (int64_t)m_length));
+            }
+        } else {
+            end = ((m_consumed + (int64_t)idone) * m_up + m_down - 1) / m_down;
+        }
+
+        reserve(idone + zeros);
+        for (unsigned int c = 0; c < m_num_channels; c++) {
+            float* history = m_history.data() + c * m_capacity + m_length;
+            if constexpr (input_interleaved) {
+                const float* src = ibuf.channel(0) + c;
+                for (size_t i = 0; i < idone; i++) {
+                    history[i] = src[i * m_num_channels];
+                }
+            } else {
+                std::copy_n(ibuf.channel(c), idone, history);
+            }
+            std::fill_n(history + idone, zeros, 0.0f);
+        }
+        m_length += idone + zeros;
+        m_consumed += idone;
+
+        const int64_t odone = std::clamp<int64_t>(end - m_next, 0, olen);
+        for (unsigned int c = 0; c < m_num_channels; c++) {
+            const float* history = m_history.data() + c * m_capacity;
+            float* dst = output_interleaved ? obuf.channel(0) + c : obuf.channel(c);
+            const size_t dst_stride = output_interleaved ? m_num_channels : 1;
+            for (int64_t i = 0; i < odone; i++) {
+                // The oldest input frame under the filter is phase_taps - 1 frames before the newest
+                const int64_t t = (m_next + i) * m_down;
+                const float* taps = m_taps + (t % m_up) * m_phase_taps;
+                const int64_t oldest = t / m_up - (int64_t)m_phase_taps + 1 - m_base;
+                dst[i * dst_stride] = detail::dot(taps, history + oldest, m_phase_taps);
+            }
+        }
+        m_next += odone;
+
+        return std::make_pair(idone, (size_t)odone);
+    }
+
+    /**
+     * Query the current delay of the resampler, in output samples: output that is owed for the input consumed so far.
+     */
+    double delay() const noexcept {
+        return (double)m_consumed * m_up / m_down - (double)(m_next - m_skip);
+    }
+
+    /**
+     * Query the name of the resampling engine.
+     */
+    char const* engine() const noexcept {
+        return detail::polyphase_engine_name;
+    }
+
+    /**
+     * Query the channel count.
+     */
+    unsigned int num_channels() const noexcept {
+        return m_num_channels;
+    }
+
+    /**
+     * Query the number of taps in each phase of the filter, which sets the cost per output sample.
+     */
+    size_t phase_taps() const noexcept {
+        return m_phase_taps;
+    }
+
+    /**
+     * Access the filter, which other resamplers with the same configuration may be sharing.
+     */
+    const std::shared_ptr<const PolyphaseFilter>& filter() const noexcept {
+        return m_filter;
+    }
+
+    /**
+     * Prepare to process a fresh signal with the same config.
+     */
+    void clear() {
+        m_length = 0;
+        m_base = 0;
+        m_consumed = 0;
+        m_next = m_skip;
+        reserve(m_phase_taps - 1);
+        // The filter starts out looking at silence before the first input frame
+        std::fill(m_history.begin(), m_history.end(), 0.0f);
+        m_length = m_phase_taps - 1;
+        m_base = -(int64_t)m_length;
+    }
+};
+
+/**
+ * Stream resampler that runs on `PolyphaseResampler` when it supports the rates and quality, and on soxr otherwise. The choice is
+ * made once at construction; `engine()` tells which one was picked. Only float samples can use the polyphase engine, other types
+ * always go to soxr. Exposes the `process` API only, since the polyphase engine has no input provider or variable-rate mode.
+ */
+template <typename InputType = float,
+          typename OutputType = float,
+          SoxrDataShape InputShape = SoxrDataShape::Interleaved,
+          SoxrDataShape OutputShape = SoxrDataShape::Interleaved>
+class AutoResampler {
+  private:
+    static constexpr bool float_types = std::is_same_v<std::remove_const_t<InputType>, float> && std::is_same_v<OutputType, float>;
+
+  public:
+    using Resampler = SoxResampler<InputType, OutputType, InputShape, OutputShape>;
+    using Polyphase =
+        std::conditional_t<float_types, PolyphaseResampler<InputType, OutputType, InputShape, OutputShape>, std::monostate>;
+    using IoSpec = SoxrIoSpec<InputType, InputShape, OutputType, OutputShape>;
+
+  private:
+    std::variant<Resampler, Polyphase> m_engine;
+
+    static std::variant<Resampler, Polyphase> create(double input_rate,
+                                                     double output_rate,
+                                                     unsigned int num_channels,
+                                                     const IoSpec& io_spec,
+                                                     const SoxrQualitySpec& quality_spec,
+                                                     const SoxrRuntimeSpec& runtime_spec) {
+        if constexpr (float_types) {
+            if (Polyphase::supports(input_rate, output_rate, quality_spec)) {
+                return std::variant<Resampler, Polyphase>(
+                    std::in_place_type<Polyphase>, input_rate, output_rate, num_channels, io_spec, quality_spec);
+            }
+        }
+        return std::variant<Resampler, Polyphase>(
+            std::in_place_type<Resampler>, input_rate, output_rate, num_channels, io_spec, quality_spec, runtime_spec);
+    }
+
+    template <typename Fn>
+    decltype(auto) dispatch(Fn&& fn) {
+        if constexpr (float_types) {
+            if (Polyphase* polyphase = std::get_if<Polyphase>(&m_engine)) {
+                return fn(*polyphase);
+            }
+        }
+        return fn(std::get<Resampler>(m_engine));
+    }
+
+  public:
+    /**
+     * Creates a stream resampler on the fastest engine that supports the configuration.
+     * @param input_rate sample rate of the input
+     * @param output_rate target sample rate of the resampled output
+     * @param num_channels channel count
+     * @param io_spec input/output configuration
+     * @param quality_spec resampling quality configuration
+     * @param runtime_spec runtime configuration, used by soxr only
+     */
+    AutoResampler(double input_rate,
+                  double output_rate,
+                  unsigned int num_channels,
+                  const IoSpec& io_spec = IoSpec(),
+                  const SoxrQualitySpec& quality_spec = SoxrQualitySpec(SoxrQualityRecipe::High, 0),
+                  const SoxrRuntimeSpec& runtime_spec = SoxrRuntimeSpec(1))
+        : m_engine(create(input_rate, output_rate, num_channels, io_spec, quality_spec, runtime_spec)) {}
+
+    /**
+     * Resamples data from the provided input buffer into the provided output buffer. Same contract as `SoxResampler::process`.
+     * @param ibuf readonly buffer to input samples
+     * @param obuf buffer to write output samples
+     * @param done true if there are no input samples and no more will be available
+     * @return The pair (`ilen`, `olen`) describing the number of samples read and written respectively.
+     */
+    template <size_t InputChannels,
+              size_t OutputChannels,
+              size_t InputExtent = std::dynamic_extent,
+              size_t OutputExtent = std::dynamic_extent>
+    std::pair<size_t, size_t> process(const SoxrBuffer<InputType, InputChannels, InputExtent>& ibuf,
+                                      SoxrBuffer<OutputType, OutputChannels, OutputExtent>& obuf,
+                                      bool done = false) {
+        return dispatch([&](auto& engine) {
+            return engine.process(ibuf, obuf, done);
+        });
+    }
+
+    /**
+     * Query the current delay of the resampler, in output samples.
+     */
+    double delay() noexcept {
+        return dispatch([](auto& engine) {
+            return engine.delay();
+        });
+    }
+
+    /**
+     * Query the name of the resampling engine, which starts with "soxrpp-polyphase" when the built-in engine is in use.
+     */
+    char const* engine() noexcept {
+        return dispatch([](auto& engine) {
+            return engine.engine();
+        });
+    }
+
+    /**
+     * Query whether the built-in polyphase engine is in use.
+     */
+    bool is_polyphase() const noexcept {
+        return float_types && m_engine.index() == 1;
+    }
+
+    /**
+     * Query the channel count.
+     */
+    unsigned int num_channels() noexcept {
+        return dispatch([](auto& engine) {
+            return engine.num_channels();
+        });
+    }
+
+    /**
+     * Prepare to process a fresh signal with the same config.
+     */
+    void clear() {
+        dispatch([](auto& engine) {
+            engine.clear();
+        });
+    }
+};
+
+} // namespace soxrpp
@@ -0,0 +1,321 @@
+#pragma once
+
+#include "soxrpp.h"
+#include "soxrpp/tuning.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numbers>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace soxrpp {
+
+/**
+ * A quality configuration to measure, with a name for reports.
+ */
+struct QualityCandidate {
+    std::string name;
+    SoxrQualitySpec quality_spec;
+};
+
+/**
+ * What a quality configuration delivers and costs for one rate pair, as measured by `measure_quality`.
+ */
+struct QualityMeasurement {
+    std::string name;
+    SoxrQualitySpec quality_spec;
+    double passband_ripple_db; // Spread of the gain over the analysis band, peak to peak
+    double aliasing_db;        // Worst spurious output from out-of-band tones, or images of in-band ones, relative to the tone
+    double snr_db;             // Worst ratio of an in-band tone to everything else in the output
+    double ns_per_frame;       // Cost of `process` per input frame, in float samples
+};
+
+/**
+ * Test signals and timing for `measure_quality`. The defaults resolve over 130 dB of SNR and take a fraction of a second per
+ * candidate.
+ */
+struct QualityAnalysisOptions {
+    // Analysis band, as a fraction of the lower of the two Nyquist frequencies
+    double passband = 0.8;
+    // Tones stepped across the analysis band, and across the band that must be rejected
+    unsigned int num_tones = 12;
+    // Input frames per tone
+    size_t tone_frames = 1 << 14;
+    // Timing workload, see `tune_runtime_spec`
+    unsigned int num_channels = 2;
+    size_t block_frames = 1024;
+    double min_time_ms = 20;
+};
+
+namespace detail {
+
+// Fraction of a step that test tones are offset by, irrational so that no tone lands on a simple fraction of either rate
+inline constexpr double tone_offset = std::numbers::phi - 1;
+
+// Level of the sinusoid at `frequency` (cycles per sample) in `x`, and of what is left after removing it, as RMS values
+inline std::pair<double, double> fit_tone(const std::vector<double>& x, double frequency) noexcept {
+    double cc = 0, ss = 0, cs = 0, xc = 0, xs = 0, xx = 0;
+    for (size_t n = 0; n < x.size(); n++) {
+        const double c = std::cos(2 * std::numbers::pi * frequency * n);
+        const double s = std::sin(2 * std::numbers::pi * frequency * n);
+        cc += c * c;
+        ss += s * s;
+        cs += c * s;
+        xc += x[n] * c;
+        xs += x[n] * s;
+        xx += x[n] * x[n];
+    }
+    // Least squares for x ~ a cos + b sin
+    const double det = cc * ss - cs * cs;
+    const double a = (xc * ss - xs * cs) / det;
+    const double b = (xs * cc - xc * cs) / det;
+    const double fitted = a * xc + b * xs;
+    const double tone = std::sqrt((a * a + b * b) / 2);
+    const double residual = std::sqrt(std::max(0.0, xx - fitted) / x.size());
+    return std::make_pair(tone, residual);
+}
+
+// Resamples a tone of `frequency` Hz and amplitude 0.5, in double precision so the filter rather than the sample type sets the
+// floor, and returns the middle of the output, away from the edge transients
+inline std::vector<double> resample_tone(
+    double input_rate, double output_rate, const SoxrQualitySpec& quality_spec, double frequency, size_t frames) {
+    std::vector<double> input(frames);
+    for (size_t n = 0; n < frames; n++) {
+        input[n] = 0.5 * std::sin(2 * std::numbers::pi * frequency * n / input_rate);
+    }
+    using IoSpec = SoxrIoSpec<double, SoxrDataShape::Interleaved, double, SoxrDataShape::Interleaved>;
+    std::vector<double> output =
+        oneshot(input_rate, output_rate, 1, SoxrBuffer<double>(input.data(), input.size()), IoSpec(), quality_spec);
+    const size_t edge = output.size() / 8;
+    return std::vector<double>(output.begin() + edge, output.end() - edge);
+}
+
+// Frequency that `frequency` Hz shows up at after sampling at `rate`
+inline double fold(double frequency, double rate) noexcept {
+    const double f = std::fmod(frequency, rate);
+    return f > rate / 2 ? rate - f : f;
+}
+
+inline double to_db(double ratio) noexcept {
+    return 20 * std::log10(std::max(ratio, 1e-20));
+}
+
+// SNR that counts aliasing as noise too, since the in-band tones alone can't show how well the stopband is rejected
+inline double effective_snr_db(const QualityMeasurement& measurement) noexcept {
+    return std::min(measurement.snr_db, -measurement.aliasing_db);
+}
+
+} // namespace detail
+
+/**
+ * The configurations worth comparing: every recipe, and the phase and steepness variants of the high-quality ones.
+ */
+inline std::vector<QualityCandidate> default_quality_candidates() {
+    struct Recipe {
+        SoxrQualityRecipe recipe;
+        const char* name;
+    };
+    const Recipe recipes[] = {
+        {SoxrQualityRecipe::Quick, "Quick"},
+        {SoxrQualityRecipe::Low, "Low"},
+        {SoxrQualityRecipe::Medium, "Medium"},
+        {SoxrQualityRecipe::High, "High"},
+        {SoxrQualityRecipe::VeryHigh, "VeryHigh"},
+        {SoxrQualityRecipe::B16, "B16"},
+        {SoxrQualityRecipe::B20, "B20"},
+        {SoxrQualityRecipe::B24, "B24"},
+        {SoxrQualityRecipe::B28, "B28"},
+        {SoxrQualityRecipe::B32, "B32"},
+        {SoxrQualityRecipe::LSR0, "LSR0"},
+        {SoxrQualityRecipe::LSR1, "LSR1"},
+        {SoxrQualityRecipe::LSR2, "LSR2"},
+    };
+    const Recipe variants[] = {
+        {SoxrQualityRecipe::IntermediatePhase, "IntermediatePhase"},
+        {SoxrQualityRecipe::MinimumPhase, "MinimumPhase"},
+        {SoxrQualityRecipe::SteepFilter, "SteepFilter"},
+    };
+
+    std::vector<QualityCandidate> candidates;
+    for (const Recipe& recipe : recipes) {
+        candidates.push_back({recipe.name, SoxrQualitySpec(recipe.recipe, 0)});
+    }
+    for (const Recipe& base : {recipes[3], recipes[4]}) {
+        for (const Recipe& variant : variants) {
+            const auto recipe = static_cast<SoxrQualityRecipe>(static_cast<unsigned long>(base.recipe) |
+                                                               static_cast<unsigned long>(variant.recipe));
+            candidates.push_back({std::string(base.name) + "+" + variant.name, SoxrQualitySpec(recipe, 0)});
+        }
+    }
+    return candidates;
+}
+
+/**
+ * Measure what a quality configuration delivers and costs for a rate pair. Tones are stepped across the analysis band to find the
+ * passband ripple and the SNR, which counts everything in the output that isn't the tone: noise, distortion and, when upsampling,
+ * images folded back into the output band. When downsampling, tones are also stepped across the band the filter has to reject,
+ * which alias into the analysis band at the levels reported by `aliasing_db`; when upsampling, that reports the images of the
+ * in-band tones that land in the output band instead. The cost is timed as in `tune_runtime_spec`, on float samples.
+ * @param input_rate sample rate of the input
+ * @param output_rate target sample rate of the resampled output
+ * @param candidate configuration to measure
+ * @param options test signals and timing
+ */
+inline QualityMeasurement measure_quality(double input_rate,
+                                          double output_rate,
+                                          const QualityCandidate& candidate,
+                                          const QualityAnalysisOptions& options = QualityAnalysisOptions()) {
+    const double nyquist = std::min(input_rate, output_rate) / 2;
+    double min_gain = std::numeric_limits<double>::infinity();
+    double max_gain = 0;
+    double snr = std::numeric_limits<double>::infinity();
+    double spurious = 0;
+    for (unsigned int k = 0; k < options.num_tones; k++) {
+        // Stepped, and offset so that no tone lands on a simple fraction of either rate
+        const double frequency = nyquist * options.passband * (k + detail::tone_offset) / options.num_tones;
+        std::vector<double> output =
+            detail::resample_tone(input_rate, output_rate, candidate.quality_spec, frequency, options.tone_frames);
+        auto [tone, residual] = detail::fit_tone(output, frequency / output_rate);
+        min_gain = std::min(min_gain, tone / (0.5 / std::numbers::sqrt2));
+        max_gain = std::max(max_gain, tone / (0.5 / std::numbers::sqrt2));
+        snr = std::min(snr, detail::to_db(tone / residual));
+        if (output_rate > input_rate) {
+            // The first image sits mirrored about the input's Nyquist frequency
+            const double image = detail::fold(input_rate - frequency, output_rate);
+            spurious = std::max(spurious, detail::fit_tone(output, image / output_rate).first / tone);
+        }
+    }
+    if (output_rate < input_rate) {
+        for (unsigned int k = 0; k < options.num_tones; k++) {
+            // Tones between the output's sample rate less the analysis band and the input's Nyquist frequency alias into the band
+            const double frequency = std::min(output_rate - nyquist * options.passband * (k + detail::tone_offset) / options.num_tones,
+                                              input_rate / 2 * (1 - detail::tone_offset / options.num_tones));
+            if (frequency <= nyquist) {
+                continue;
+            }
+            std::vector<double> output =
+                detail::resample_tone(input_rate, output_rate, candidate.quality_spec, frequency, options.tone_frames);
+            const double alias = detail::fold(frequency, output_rate);
+            spurious = std::max(spurious, detail::fit_tone(output, alias / output_rate).first / (0.5 / std::numbers::sqrt2));
+        }
+    }
+
+    return QualityMeasurement{
+        .name = candidate.name,
+        .quality_spec = candidate.quality_spec,
+        .passband_ripple_db = detail::to_db(max_gain / min_gain),
+        .aliasing_db = detail::to_db(spurious),
+        .snr_db = snr,
+        .ns_per_frame = detail::measure_runtime_spec(input_rate,
+                                                     output_rate,
+                                                     options.num_channels,
+                                                     options.block_frames,
+                                                     candidate.quality_spec,
+                                                     SoxrRuntimeSpec(1),
+                                                     options.min_time_ms),
+    };
+}
+
+/**
+ * Measure every candidate for a rate pair; see `measure_quality`. Candidates that soxr rejects are left out.
+ * @param input_rate sample rate of the input
+ * @param output_rate target sample rate of the resampled output
+ * @param candidates configurations to measure
+ * @param options test signals and timing
+ * @return The measurements, cheapest first.
+ */
+inline std::vector<QualityMeasurement> analyze_quality(double input_rate,
+                                                       double output_rate,
+                                                       const std::vector<QualityCandidate>& candidates = default_quality_candidates(),
+                                                       const QualityAnalysisOptions& options = QualityAnalysisOptions()) {
+    std::vector<QualityMeasurement> table;
+    for (const QualityCandidate& candidate : candidates) {
+        try {
+            table.push_back(measure_quality(input_rate, output_rate, candidate, options));
+        } catch (const SoxrError&) {
+        }
+    }
+    std::sort(table.begin(), table.end(), [](const QualityMeasurement& a, const QualityMeasurement& b) {
+        return a.ns_per_frame < b.ns_per_frame;
+    });
+    return table;
+}
+
+/**
+ * Keep the measurements that no other one beats on both cost and SNR, where the SNR is the lower of `snr_db` and `-aliasing_db`
+ * so that a configuration with a clean passband but poor stopband rejection doesn't rank above one that rejects aliases.
+ * @param table measurements, as from `analyze_quality`
+ * @return The Pareto front, cheapest first, with SNR rising along it.
+ */
+inline std::vector<QualityMeasurement> pareto_front(std::vector<QualityMeasurement> table) {
+    std::sort(table.begin(), table.end(), [](const QualityMeasurement& a, const QualityMeasurement& b) {
+        return a.ns_per_frame < b.ns_per_frame ||
+               (a.ns_per_frame == b.ns_per_frame && detail::effective_snr_db(a) > detail::effective_snr_db(b));
+    });
+    std::vector<QualityMeasurement> front;
+    for (QualityMeasurement& measurement : table) {
+        if (front.empty() || detail::effective_snr_db(measurement) > detail::effective_snr_db(front.back())) {
+            front.push_back(std::move(measurement));
+        }
+    }
+    return front;
+}
+
+/**
+ * Requirements for `select_quality`. Set either or both.
+ */
+struct QualityRequirement {
+    // Checked against the lower of `snr_db` and `-aliasing_db`, as on the Pareto front
+    double min_snr_db = -std::numeric_limits<double>::infinity();
+    double max_ns_per_frame = std::numeric_limits<double>::infinity();
+};
+
+/**
+ * Pick from measurements the configuration that meets the requirement: the cheapest one with at least `min_snr_db` of SNR, or,
+ * if only a budget is given, the one with the best SNR within `max_ns_per_frame`. Aliasing counts against the SNR; see
+ * `pareto_front`.
+ * @param table measurements, as from `analyze_quality`
+ * @param requirement SNR to reach and CPU budget to stay within
+ * @return The chosen measurement, or nothing if no configuration meets the requirement.
+ */
+inline std::optional<QualityMeasurement> select_quality(const std::vector<QualityMeasurement>& table,
+                                                        const QualityRequirement& requirement) {
+    std::optional<QualityMeasurement> best;
+    const bool snr_target = std::isfinite(requirement.min_snr_db);
+    for (const QualityMeasurement& measurement : pareto_front(table)) {
+        if (detail::effective_snr_db(measurement) < requirement.min_snr_db ||
+            measurement.ns_per_frame > requirement.max_ns_per_frame) {
+            continue;
+        }
+        // The front is sorted by cost with SNR rising, so the first match is the cheapest and the last is the best
+        best = measurement;
+        if (snr_target) {
+            break;
+        }
+    }
+    return best;
+}
+
+/**
+ * Measure the candidates for a rate pair and pick the `SoxrQualitySpec` that meets the requirement; see `select_quality`. The
+ * measurements take about a second, so keep the table from `analyze_quality` when selecting more than once for the same rates.
+ * @param input_rate sample rate of the input
+ * @param output_rate target sample rate of the resampled output
+ * @param requirement SNR to reach and CPU budget to stay within
+ * @param options test signals and timing
+ * @return The chosen quality spec, or nothing if no candidate meets the requirement.
+ */
+inline std::optional<SoxrQualitySpec> select_quality_spec(double input_rate,
+                                                          double output_rate,
+                                                          const QualityRequirement& requirement,
+                                                          const QualityAnalysisOptions& options = QualityAnalysisOptions()) {
+    std::optional<QualityMeasurement> chosen =
+        select_quality(analyze_quality(input_rate, output_rate, default_quality_candidates(), options), requirement);
+    return chosen ? std::make_optional(chosen->quality_spec) : std::nullopt;
+}
+
+} // namespace soxrpp
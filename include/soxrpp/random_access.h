@@ -0,0 +1,262 @@
+#pragma once
+
+#include "soxrpp.h"
+#include "soxrpp/parallel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <list>
+#include <numeric>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace soxrpp {
+
+/**
+ * Snapshot of the counters kept by a `ResampledView`.
+ */
+struct ResampledViewStats {
+    size_t hits;      // Blocks served from the cache
+    size_t misses;    // Blocks that had to be resampled
+    size_t evictions; // Blocks dropped to stay within capacity
+    size_t cached;    // Blocks currently held by the cache
+};
+
+/**
+ * Random-access view of a signal held in memory (or memory-mapped) as it would be after resampling, for editors and analysis tools
+ * that seek around long recordings. The output is cut into fixed blocks, and a block is resampled on its own from just the input
+ * it depends on: it starts on a period boundary of the rate ratio so that its samples fall at the same instants as in a single
+ * pass, and a warm-up derived from the filter length is fed ahead of it and trimmed off, as in `segmented_oneshot`. Reads
+ * therefore match `oneshot` up to rounding noise below the requested precision, and cost the same wherever they land. The most
+ * recently used blocks are kept, up to `cache_blocks` of them, so repeated and nearby reads don't resample anything.
+ *
+ * Rates must be whole numbers, and variable-rate resampling isn't supported. Interleaved data only; not thread-safe, since reads
+ * update the cache.
+ */
+template <typename InputType = float, typename OutputType = float>
+class ResampledView {
+    static_assert(!std::is_const_v<OutputType>, "OutputType cannot be const");
+
+  private:
+    using RawInputType = std::remove_const_t<InputType>;
+
+  public:
+    using Resampler = SoxResampler<const RawInputType, OutputType>;
+    using IoSpec = SoxrIoSpec<const RawInputType, SoxrDataShape::Interleaved, OutputType, SoxrDataShape::Interleaved>;
+
+  private:
+    // The largest period a rate pair may have, in output frames, so blocks stay reasonably small
+    static constexpr size_t max_period = 1 << 16;
+
+    struct Block {
+        size_t index;
+        std::vector<OutputType> samples;
+    };
+
+    const RawInputType* m_input;
+    size_t m_input_frames;
+    double m_input_rate;
+    double m_output_rate;
+    unsigned int m_num_channels;
+    Resampler m_resampler;
+    // One period is `m_period_in` input frames and exactly `m_period_out` output frames
+    size_t m_period_in{0};
+    size_t m_period_out{0};
+    size_t m_warmup_periods{0};
+    // Output frames per block, a whole number of periods
+    size_t m_block_frames{0};
+    size_t m_output_frames{0};
+    size_t m_cache_blocks;
+    // Cached blocks, most recently used first
+    std::list<Block> m_blocks;
+    std::unordered_map<size_t, typename std::list<Block>::iterator> m_index;
+    std::vector<OutputType> m_scratch;
+    ResampledViewStats m_stats{};
+
+    // Resamples output block `index` into `samples`
+    void render(size_t index, std::vector<OutputType>& samples) {
+        const size_t obegin = index * m_block_frames;
+        const size_t count = std::min(m_block_frames, m_output_frames - obegin);
+        const size_t first_period = obegin / m_period_out;
+        const size_t ibegin = (first_period > m_warmup_periods ? first_period - m_warmup_periods : 0) * m_period_in;
+        const size_t iend = std::min(m_input_frames, ((obegin + count) / m_period_out + m_warmup_periods + 1) * m_period_in);
+        const size_t skip = obegin - ibegin / m_period_in * m_period_out;
+        const size_t wanted = skip + count;
+
+        // Flushing at `iend` is harmless, since the warm-up past the block keeps the zero padding out of the filter's reach
+        m_resampler.clear();
+        size_t consumed = 0;
+        size_t produced = 0;
+        bool done = false;
+        while (produced < wanted) {
+            SoxrBuffer<const RawInputType> ibuf(m_input + (ibegin + consumed) * m_num_channels,
+                                                (iend - ibegin - consumed) * m_num_channels);
+            SoxrBuffer<OutputType> obuf(m_scratch.data() + produced * m_num_channels, m_scratch.size() - produced * m_num_channels);
+            auto [idone, odone] = m_resampler.process(ibuf, obuf, done);
+            consumed += idone;
+            produced += odone;
+            if (done && odone == 0) {
+                break;
+            }
+            done = consumed == iend - ibegin;
+        }
+        if (produced < wanted) {
+            throw SoxrError("Block produced less output than expected");
+        }
+        samples.assign(m_scratch.begin() + skip * m_num_channels, m_scratch.begin() + wanted * m_num_channels);
+    }
+
+    // Finds block `index` in the cache, or resamples it into the least recently used slot
+    const OutputType* block(size_t index) {
+        if (auto it = m_index.find(index); it != m_index.end()) {
+            m_blocks.splice(m_blocks.begin(), m_blocks, it->second);
+            m_stats.hits++;
+            return m_blocks.front().samples.data();
+        }
+        m_stats.misses++;
+        if (m_blocks.size() >= m_cache_blocks) {
+            // Reuse the evicted block's storage
+            m_blocks.splice(m_blocks.begin(), m_blocks, std::prev(m_blocks.end()));
+            m_index.erase(m_blocks.front().index);
+            m_stats.evictions++;
+        } else {
+            m_blocks.emplace_front();
+        }
+        Block& block = m_blocks.front();
+        block.index = index;
+        m_index[index] = m_blocks.begin();
+        try {
+            render(index, block.samples);
+        } catch (...) {
+            m_index.erase(index);
+            m_blocks.pop_front();
+            throw;
+        }
+        return block.samples.data();
+    }
+
+  public:
+    /**
+     * Creates a view of the resampled signal. The input isn't copied and must outlive the view.
+     * @param input_rate sample rate of the input, a whole number
+     * @param output_rate target sample rate of the resampled output, a whole number
+     * @param num_channels channel count
+     * @param ibuf buffer of all the interleaved input frames
+     * @param block_frames output frames resampled at a time, rounded up to a whole number of periods of the rate ratio
+     * @param cache_blocks number of blocks to keep
+     * @param io_spec input/output configuration
+     * @param quality_spec resampling quality configuration, without `SoxrQualityFlags::VariableRate`
+     * @param runtime_spec runtime configuration
+     */
+    template <size_t Extent = std::dynamic_extent>
+    ResampledView(double input_rate,
+                  double output_rate,
+                  unsigned int num_channels,
+                  const SoxrBuffer<InputType, 1, Extent>& ibuf,
+                  size_t block_frames = 4096,
+                  size_t cache_blocks = 64,
+                  const IoSpec& io_spec = IoSpec(),
+                  const SoxrQualitySpec& quality_spec = SoxrQualitySpec(SoxrQualityRecipe::High, 0),
+                  const SoxrRuntimeSpec& runtime_spec = SoxrRuntimeSpec(1))
+        : m_input(ibuf.channel(0))
+        , m_input_frames(ibuf.size(true, num_channels))
+        , m_input_rate(input_rate)
+        , m_output_rate(output_rate)
+        , m_num_channels(num_channels)
+        , m_resampler(input_rate, output_rate, num_channels, io_spec, quality_spec, runtime_spec)
+        , m_cache_blocks(std::max<size_t>(1, cache_blocks)) //
+    {
+        // Blocks can only be resampled on their own if they start on an input frame that lines up with an output frame
+        if (input_rate < 1 || output_rate < 1 || std::floor(input_rate) != input_rate || std::floor(output_rate) != output_rate) {
+            throw SoxrError("Resampled views need whole-number sample rates");
+        }
+        if (quality_spec.flags & SoxrQualityFlags::VariableRate) {
+            throw SoxrError("Resampled views can't be variable-rate");
+        }
+        const size_t divisor = std::gcd((size_t)input_rate, (size_t)output_rate);
+        m_period_in = (size_t)input_rate / divisor;
+        m_period_out = (size_t)output_rate / divisor;
+        if (m_period_out > max_period) {
+            throw SoxrError("The rate ratio's period is too long for a resampled view");
+        }
+        m_block_frames = std::max<size_t>(1, (block_frames + m_period_out - 1) / m_period_out) * m_period_out;
+        m_output_frames = output_frames(m_input_frames, input_rate, output_rate);
+
+        const size_t warmup = detail::filter_warmup(input_rate, output_rate, quality_spec, runtime_spec);
+        m_warmup_periods = (warmup + m_period_in - 1) / m_period_in;
+
+        // A block's output, plus the warm-up ahead of it and the flush after it
+        const size_t most = (m_block_frames / m_period_out + 2 * m_warmup_periods + 2) * m_period_out + 64;
+        m_scratch.assign(most * num_channels, OutputType{});
+    }
+
+    /**
+     * Read resampled frames starting at any output frame. Frames past the end of the signal aren't written.
+     * @param offset index of the first output frame to read
+     * @param obuf buffer to write interleaved output frames, as many as it holds
+     * @return The number of frames written.
+     */
+    template <size_t Extent = std::dynamic_extent>
+    size_t read(size_t offset, const SoxrBuffer<OutputType, 1, Extent>& obuf) {
+        const size_t end = std::min(m_output_frames, offset + obuf.size(true, m_num_channels));
+        OutputType* dst = obuf.channel(0);
+        for (size_t frame = offset; frame < end;) {
+            const size_t index = frame / m_block_frames;
+            const size_t within = frame - index * m_block_frames;
+            const size_t count = std::min(end, (index + 1) * m_block_frames) - frame;
+            std::copy_n(block(index) + within * m_num_channels, count * m_num_channels, dst);
+            dst += count * m_num_channels;
+            frame += count;
+        }
+        return end > offset ? end - offset : 0;
+    }
+
+    /**
+     * Query the total number of output frames, as `output_frames` of the input.
+     */
+    size_t size() const noexcept {
+        return m_output_frames;
+    }
+
+    /**
+     * Query the number of output frames resampled at a time.
+     */
+    size_t block_frames() const noexcept {
+        return m_block_frames;
+    }
+
+    /**
+     * Query the number of input frames fed ahead of each block, and after it, to warm the filter up.
+     */
+    size_t warmup_frames() const noexcept {
+        return m_warmup_periods * m_period_in;
+    }
+
+    /**
+     * Query the channel count.
+     */
+    unsigned int num_channels() const noexcept {
+        return m_num_channels;
+    }
+
+    /**
+     * Query the cache's counters.
+     */
+    ResampledViewStats stats() const noexcept {
+        ResampledViewStats stats = m_stats;
+        stats.cached = m_blocks.size();
+        return stats;
+    }
+
+    /**
+     * Drop every cached block, for example after the input has been edited in place.
+     */
+    void clear() {
+        m_blocks.clear();
+        m_index.clear();
+    }
+};
+
+} // namespace soxrpp
@@ -0,0 +1,276 @@
+#pragma once
+
+#include "soxrpp.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+namespace soxrpp {
+
+/**
+ * Stream resampler for audio device callbacks that need exactly `block_frames` output frames per period. Every `process` call
+ * consumes one period's worth of input and writes exactly one block, with any surplus kept in an internal queue for the next call.
+ *
+ * soxr releases output in bursts, so the queue starts out holding enough silence to cover the longest gap between bursts. That
+ * amount, the queue's capacity and the worst-case latency are measured at construction by running the resampler over silence on
+ * the same schedule of input blocks, and then fixed. The run is then replayed from the preroll to warm the resampler up, so that
+ * after construction nothing is allocated and the latency never grows. Interleaved data only; single-threaded, so call it from
+ * the callback itself.
+ */
+template <typename InputType = float, typename OutputType = float>
+class FixedBlockResampler {
+  private:
+    using RawInputType = std::remove_const_t<InputType>;
+
+  public:
+    using Resampler = SoxResampler<const RawInputType, OutputType>;
+    using IoSpec = SoxrIoSpec<const RawInputType, SoxrDataShape::Interleaved, OutputType, SoxrDataShape::Interleaved>;
+
+  private:
+    double m_ratio;
+    unsigned int m_num_channels;
+    size_t m_block_frames;
+    size_t m_max_input_frames;
+    Resampler m_resampler;
+    // Queue of resampled frames in [m_head, m_tail), moved back to the front when it runs out of room at the end
+    std::vector<OutputType> m_queue;
+    size_t m_head{0};
+    size_t m_tail{0};
+    size_t m_preroll{0};
+    double m_max_delay{0};
+    // Periods the calibration ran for, replayed over silence by every warm-up
+    size_t m_warmup_periods{0};
+    // Periods and input frames so far, for spreading the fractional part of the ratio over the periods
+    size_t m_periods{0};
+    size_t m_input_total{0};
+    size_t m_underruns{0};
+    size_t m_overruns{0};
+
+    size_t queued() const noexcept {
+        return m_tail - m_head;
+    }
+
+    // Resamples all of `ibuf` into the queue, returning the number of frames that didn't fit
+    size_t fill(const RawInputType* input, size_t frames) {
+        size_t consumed = 0;
+        while (true) {
+            if (m_head > 0 && m_tail * m_num_channels == m_queue.size()) {
+                std::memmove(m_queue.data(), m_queue.data() + m_head * m_num_channels, queued() * m_num_channels * sizeof(OutputType));
+                m_tail -= m_head;
+                m_head = 0;
+            }
+            SoxrBuffer<const RawInputType> ibuf(input + consumed * m_num_channels, (frames - consumed) * m_num_channels);
+            SoxrBuffer<OutputType> obuf(m_queue.data() + m_tail * m_num_channels, m_queue.size() - m_tail * m_num_channels);
+            auto [idone, odone] = m_resampler.process(ibuf, obuf);
+            consumed += idone;
+            m_tail += odone;
+            // Stop once soxr has had the whole input and left room in the queue, or when the queue is full for good
+            const bool room = m_tail * m_num_channels < m_queue.size();
+            if ((consumed == frames && room) || (idone == 0 && odone == 0 && (m_head == 0 || room))) {
+                break;
+            }
+        }
+        return frames - consumed;
+    }
+
+    void reset_schedule() {
+        m_head = 0;
+        m_tail = m_preroll;
+        std::fill(m_queue.begin(), m_queue.end(), OutputType{});
+        m_periods = 0;
+        m_input_total = 0;
+        m_underruns = 0;
+        m_overruns = 0;
+    }
+
+    // Replays the calibration run over silence from the preroll, so that soxr sets up its state, which it does lazily after a clear,
+    // and the queue reaches its steady state before the first real period
+    void warm_up() {
+        std::vector<RawInputType> silence(m_max_input_frames * m_num_channels);
+        std::vector<OutputType> scratch(m_block_frames * m_num_channels);
+        for (size_t k = 0; k < m_warmup_periods; k++) {
+            process(SoxrBuffer<InputType>(silence.data(), input_frames() * m_num_channels),
+                    SoxrBuffer<OutputType>(scratch.data(), scratch.size()));
+        }
+        m_underruns = 0;
+        m_overruns = 0;
+    }
+
+    // Runs the resampler over silence until its bursts repeat, and sizes the preroll and the queue from what it produced
+    void calibrate() {
+        m_queue.assign((4 * (m_block_frames + m_max_input_frames) + 4096) * m_num_channels, OutputType{});
+        m_preroll = 0;
+        reset_schedule();
+        std::vector<RawInputType> silence(m_max_input_frames * m_num_channels);
+
+        size_t produced = 0;
+        size_t first_output = 0;
+        // Shortfall of the output so far behind the blocks demanded, and how far ahead of them it gets
+        double shortfall = 0;
+        double surplus = 0;
+        double delay = 0;
+        for (size_t k = 1; k < 65536; k++) {
+            const size_t frames = input_frames();
+            m_input_total += frames;
+            m_periods++;
+            const size_t before = queued();
+            fill(silence.data(), frames);
+            produced += queued() - before;
+            if (produced > 0 && first_output == 0) {
+                first_output = k;
+            }
+            const double demanded = (double)k * m_block_frames;
+            shortfall = std::max(shortfall, demanded - (double)produced);
+            surplus = std::max(surplus, (double)produced - (demanded - m_block_frames));
+            delay = std::max(delay, m_resampler.delay() + (double)produced - demanded);
+            m_head += std::min(queued(), m_block_frames);
+            m_warmup_periods = k;
+            if (first_output > 0 && k >= 64 && k >= 4 * first_output) {
+                break;
+            }
+        }
+
+        m_preroll = (size_t)std::ceil(shortfall);
+        m_max_delay = m_preroll + delay;
+        m_queue.assign((m_preroll + (size_t)std::ceil(surplus) + m_block_frames) * m_num_channels, OutputType{});
+        m_resampler.clear();
+        reset_schedule();
+        warm_up();
+    }
+
+  public:
+    /**
+     * Creates a fixed-block resampler, calibrates it and warms it up, which runs the resampler for a few hundred periods twice.
+     * @param input_rate sample rate of the input
+     * @param output_rate target sample rate of the resampled output
+     * @param num_channels channel count
+     * @param block_frames number of output frames produced by every `process` call
+     * @param io_spec input/output configuration
+     * @param quality_spec resampling quality configuration
+     * @param runtime_spec runtime configuration
+     */
+    FixedBlockResampler(double input_rate,
+                        double output_rate,
+                        unsigned int num_channels,
+                        size_t block_frames,
+                        const IoSpec& io_spec = IoSpec(),
+                        const SoxrQualitySpec& quality_spec = SoxrQualitySpec(SoxrQualityRecipe::High, 0),
+                        const SoxrRuntimeSpec& runtime_spec = SoxrRuntimeSpec(1))
+        : m_ratio(input_rate / output_rate)
+        , m_num_channels(num_channels)
+        , m_block_frames(block_frames)
+        , m_max_input_frames((size_t)std::ceil(block_frames * input_rate / output_rate) + 1)
+        , m_resampler(input_rate, output_rate, num_channels, io_spec, quality_spec, runtime_spec) //
+    {
+        if (block_frames == 0) {
+            throw SoxrError("Blocks must hold at least one frame");
+        }
+        calibrate();
+    }
+
+    /**
+     * Query the number of input frames that the next `process` call should be given. Alternates between the two whole numbers around
+     * `block_frames * input_rate / output_rate` so that the input keeps exact pace with the output over time.
+     */
+    size_t input_frames() const noexcept {
+        return (size_t)std::llround((double)(m_periods + 1) * m_block_frames * m_ratio) - m_input_total;
+    }
+
+    /**
+     * Query the largest number of input frames that one `process` call accepts.
+     */
+    size_t max_input_frames() const noexcept {
+        return m_max_input_frames;
+    }
+
+    /**
+     * Resample one period. `ibuf` should hold `input_frames()` frames, as when pulling input from a source on demand, or about that
+     * many, as when a capture device delivers them; small deviations are absorbed by the queue, and persistent ones show up as
+     * underruns or overruns. Frames beyond `max_input_frames()`, or that don't fit in the queue, are dropped and counted as an
+     * overrun. If the queue runs dry, the rest of the block is filled with zeros and counted as an underrun.
+     * @param ibuf buffer of interleaved input frames
+     * @param obuf buffer of at least `block_frames` interleaved output frames, of which exactly `block_frames` are written
+     * @return The number of resampled frames written, which is `block_frames` unless there was an underrun.
+     * @throws SoxrError if `obuf` holds fewer than `block_frames` frames.
+     */
+    template <size_t InputExtent = std::dynamic_extent, size_t OutputExtent = std::dynamic_extent>
+    size_t process(const SoxrBuffer<InputType, 1, InputExtent>& ibuf, const SoxrBuffer<OutputType, 1, OutputExtent>& obuf) {
+        if (obuf.size(true, m_num_channels) < m_block_frames) {
+            throw SoxrError("Output buffer holds fewer than block_frames frames");
+        }
+        const size_t given = ibuf.size(true, m_num_channels);
+        const size_t frames = std::min(given, m_max_input_frames);
+        m_periods++;
+        m_input_total += frames;
+        if (fill(ibuf.channel(0), frames) > 0 || frames < given) {
+            m_overruns++;
+        }
+
+        const size_t written = std::min(queued(), m_block_frames);
+        std::copy_n(m_queue.data() + m_head * m_num_channels, written * m_num_channels, obuf.channel(0));
+        m_head += written;
+        if (written < m_block_frames) {
+            std::fill_n(obuf.channel(0) + written * m_num_channels, (m_block_frames - written) * m_num_channels, OutputType{});
+            m_underruns++;
+        }
+        return written;
+    }
+
+    /**
+     * Query the current latency from input to output, in output frames: the resampler's delay plus the frames queued.
+     */
+    double delay() noexcept {
+        return m_resampler.delay() + (double)queued();
+    }
+
+    /**
+     * Query the worst-case latency from input to output, in output frames, as measured at construction. Holds as long as each call
+     * is given `input_frames()` frames.
+     */
+    double max_delay() const noexcept {
+        return m_max_delay;
+    }
+
+    /**
+     * Query the number of frames of silence the queue is primed with before the warm-up, to cover the longest gap between bursts.
+     */
+    size_t preroll_frames() const noexcept {
+        return m_preroll;
+    }
+
+    /**
+     * Query the number of output frames produced by every `process` call.
+     */
+    size_t block_frames() const noexcept {
+        return m_block_frames;
+    }
+
+    /**
+     * Query the number of `process` calls that ran out of resampled frames.
+     */
+    size_t underruns() const noexcept {
+        return m_underruns;
+    }
+
+    /**
+     * Query the number of `process` calls that had to drop input frames.
+     */
+    size_t overruns() const noexcept {
+        return m_overruns;
+    }
+
+    /**
+     * Prepare to process a fresh signal with the same config, starting again from the preroll and warming up again. Allocates, so
+     * call it outside the callback.
+     */
+    void clear() {
+        m_resampler.clear();
+        reset_schedule();
+        warm_up();
+    }
+};
+
+} // namespace soxrpp
@@ -0,0 +1,342 @@
+#pragma once
+
+#include "soxrpp.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <span>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace soxrpp {
+
+/**
+ * Lock-free single-producer/single-consumer ring buffer of interleaved frames. One thread may write and another may read
+ * concurrently without locks; the storage is allocated once by the constructor.
+ */
+template <typename Type>
+class SpscRing {
+  private:
+    std::vector<Type> m_samples;
+    size_t m_capacity;
+    unsigned int m_num_channels;
+    // Monotonic frame counters; each is only written by one side
+    alignas(64) std::atomic<size_t> m_write{0};
+    alignas(64) std::atomic<size_t> m_read{0};
+
+  public:
+    /**
+     * Creates an empty ring.
+     * @param capacity maximum number of frames held at once
+     * @param num_channels samples per frame
+     */
+    SpscRing(size_t capacity, unsigned int num_channels)
+        : m_samples(capacity * num_channels)
+        , m_capacity(capacity)
+        , m_num_channels(num_channels) {}
+
+    /**
+     * Query the number of frames that can be read. Safe to call from the consumer.
+     */
+    size_t readable() const noexcept {
+        return m_write.load(std::memory_order_acquire) - m_read.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Query the number of frames that can be written. Safe to call from the producer.
+     */
+    size_t writable() const noexcept {
+        return m_capacity - (m_write.load(std::memory_order_relaxed) - m_read.load(std::memory_order_acquire));
+    }
+
+    /**
+     * Returns the contiguous run of free frames that starts at the write position, which may be shorter than `writable()` if it
+     * wraps around. Producer only; follow with `commit_write`.
+     */
+    std::span<Type> write_region() noexcept {
+        size_t write = m_write.load(std::memory_order_relaxed);
+        size_t frames = std::min(writable(), m_capacity - write % m_capacity);
+        return std::span<Type>(m_samples.data() + write % m_capacity * m_num_channels, frames * m_num_channels);
+    }
+
+    /**
+     * Publishes `frames` frames written into `write_region` to the consumer.
+     */
+    void commit_write(size_t frames) noexcept {
+        m_write.store(m_write.load(std::memory_order_relaxed) + frames, std::memory_order_release);
+    }
+
+    /**
+     * Returns the contiguous run of filled frames that starts at the read position, which may be shorter than `readable()` if it
+     * wraps around. Consumer only; follow with `commit_read`.
+     */
+    std::span<const Type> read_region() const noexcept {
+        size_t read = m_read.load(std::memory_order_relaxed);
+        size_t frames = std::min(readable(), m_capacity - read % m_capacity);
+        return std::span<const Type>(m_samples.data() + read % m_capacity * m_num_channels, frames * m_num_channels);
+    }
+
+    /**
+     * Releases `frames` frames read from `read_region` back to the producer.
+     */
+    void commit_read(size_t frames) noexcept {
+        m_read.store(m_read.load(std::memory_order_relaxed) + frames, std::memory_order_release);
+    }
+};
+
+enum class StreamingMode {
+    // Resample inside `pull`, on the consumer's thread
+    Consumer,
+    // Resample on a thread owned by the `StreamingResampler`, which polls for new input
+    Dedicated
+};
+
+/**
+ * Stream resampler that connects a producer thread to a consumer thread through lock-free input and output rings, for use from
+ * real-time audio callbacks. `push` and `pull` never lock, and the wrapper never allocates after construction. The producer pushes
+ * whatever frames it has and the consumer pulls exactly as many frames as it needs; shortfalls and excess are counted as underruns
+ * and overruns instead of blocking.
+ */
+template <typename InputType = float,
+          typename OutputType = float,
+          SoxrDataShape InputShape = SoxrDataShape::Interleaved,
+          SoxrDataShape OutputShape = SoxrDataShape::Interleaved>
+class StreamingResampler {
+  private:
+    using RawInputType = std::remove_const_t<InputType>;
+    using Resampler = SoxResampler<const RawInputType, OutputType, SoxrDataShape::Interleaved, SoxrDataShape::Interleaved>;
+
+    unsigned int m_num_channels;
+    Resampler m_resampler;
+    SpscRing<RawInputType> m_input;
+    SpscRing<OutputType> m_output;
+    StreamingMode m_mode;
+    std::atomic<size_t> m_underruns{0};
+    std::atomic<size_t> m_overruns{0};
+    std::atomic<bool> m_stop{false};
+    std::atomic<bool> m_failed{false};
+    std::thread m_thread;
+
+    static SoxrIoSpec<const RawInputType, SoxrDataShape::Interleaved, OutputType, SoxrDataShape::Interleaved> interleaved_io_spec(
+        const SoxrIoSpec<InputType, InputShape, OutputType, OutputShape>& io_spec) {
+        SoxrIoSpec<const RawInputType, SoxrDataShape::Interleaved, OutputType, SoxrDataShape::Interleaved> result;
+        result.scale = io_spec.scale;
+        result.flags = io_spec.flags;
+        return result;
+    }
+
+    // Runs the resampler over silence in blocks as large as the rings allow, until its output has settled, so that soxr sets up its
+    // state and grows its buffers here rather than on the first real-time call. The output is drained every time, so nothing but
+    // the filter's own delay is left inside
+    void warm_up(double input_rate, double output_rate, size_t input_capacity, size_t output_capacity) {
+        if (input_capacity == 0 || output_capacity == 0) {
+            return;
+        }
+        std::vector<RawInputType> silence(input_capacity * m_num_channels);
+        std::vector<OutputType> scratch(std::max(output_capacity, output_frames(input_capacity, input_rate, output_rate) + 16) *
+                                        m_num_channels);
+        auto ibuf = SoxrBuffer<const RawInputType>(silence.data(), silence.size());
+        auto obuf = SoxrBuffer<OutputType>(scratch.data(), scratch.size());
+        size_t first_output = 0;
+        for (size_t k = 1; k < 65536; k++) {
+            auto [idone, odone] = m_resampler.process(ibuf, obuf);
+            if (odone > 0 && first_output == 0) {
+                first_output = k;
+            }
+            if (first_output > 0 && k >= 64 && k >= 4 * first_output) {
+                break;
+            }
+        }
+    }
+
+    // Moves as much as possible from the input ring through the resampler into the output ring; false if nothing moved. An error
+    // sets m_failed instead of throwing, since building the exception would allocate on a real-time thread
+    bool pump() noexcept {
+        auto iregion = m_input.read_region();
+        auto oregion = m_output.write_region();
+        if (oregion.empty() || m_failed.load(std::memory_order_relaxed)) {
+            return false;
+        }
+        auto ibuf = SoxrBuffer<const RawInputType>(iregion.data(), iregion.size());
+        auto obuf = SoxrBuffer<OutputType>(oregion.data(), oregion.size());
+        auto result = m_resampler.try_process(ibuf, obuf);
+        if (!result) {
+            m_failed = true;
+            return false;
+        }
+        auto [idone, odone] = *result;
+        m_input.commit_read(idone);
+        m_output.commit_write(odone);
+        return idone > 0 || odone > 0;
+    }
+
+  public:
+    /**
+     * Creates a streaming resampler and warms it up over silence, so that the first `pull` or pump finds soxr ready. In
+     * `StreamingMode::Dedicated` a resampling thread is then started.
+     * @param input_rate sample rate of the input
+     * @param output_rate target sample rate of the resampled output
+     * @param num_channels channel count
+     * @param input_capacity number of input frames the producer can push ahead of the resampler
+     * @param output_capacity number of resampled frames held for the consumer
+     * @param mode which thread runs the resampler
+     * @param io_spec input/output configuration
+     * @param quality_spec resampling quality configuration
+     * @param runtime_spec runtime configuration
+     * @param poll_interval how long the dedicated thread sleeps when there is nothing to do
+     */
+    StreamingResampler(double input_rate,
+                       double output_rate,
+                       unsigned int num_channels,
+                       size_t input_capacity,
+                       size_t output_capacity,
+                       StreamingMode mode = StreamingMode::Consumer,
+                       const SoxrIoSpec<InputType, InputShape, OutputType, OutputShape>& io_spec =
+                           SoxrIoSpec<InputType, InputShape, OutputType, OutputShape>(),
+                       const SoxrQualitySpec& quality_spec = SoxrQualitySpec(SoxrQualityRecipe::High, 0),
+                       const SoxrRuntimeSpec& runtime_spec = SoxrRuntimeSpec(1),
+                       std::chrono::microseconds poll_interval = std::chrono::microseconds(500))
+        : m_num_channels(num_channels)
+        , m_resampler(input_rate, output_rate, num_channels, interleaved_io_spec(io_spec), quality_spec, runtime_spec)
+        , m_input(input_capacity, num_channels)
+        , m_output(output_capacity, num_channels)
+        , m_mode(mode) //
+    {
+        // soxr sets its state up again lazily after a clear, so warm up after it too; the silence left inside is part of the latency
+        warm_up(input_rate, output_rate, input_capacity, output_capacity);
+        m_resampler.clear();
+        warm_up(input_rate, output_rate, input_capacity, output_capacity);
+        if (m_mode == StreamingMode::Dedicated) {
+            m_thread = std::thread([this, poll_interval] {
+                // After an error the consumer sees underruns and can check failed()
+                while (!m_stop.load(std::memory_order_relaxed) && !m_failed.load(std::memory_order_relaxed)) {
+                    if (!pump()) {
+                        std::this_thread::sleep_for(poll_interval);
+                    }
+                }
+            });
+        }
+    }
+
+    StreamingResampler(const StreamingResampler&) = delete;
+    StreamingResampler& operator=(const StreamingResampler&) = delete;
+
+    ~StreamingResampler() {
+        m_stop = true;
+        if (m_thread.joinable()) {
+            m_thread.join();
+        }
+    }
+
+    /**
+     * Queue input frames for resampling. Producer thread only. Frames that don't fit are dropped and counted as an overrun.
+     * @param ibuf buffer of input frames, shaped according to `InputShape`
+     * @return The number of frames accepted.
+     */
+    template <size_t Channels, size_t Extent = std::dynamic_extent>
+    size_t push(const SoxrBuffer<InputType, Channels, Extent>& ibuf) noexcept {
+        constexpr bool interleaved = InputShape == SoxrDataShape::Interleaved;
+        const size_t frames = ibuf.size(interleaved, m_num_channels);
+        size_t pushed = 0;
+        while (pushed < frames) {
+            auto region = m_input.write_region();
+            size_t n = std::min(frames - pushed, region.size() / m_num_channels);
+            if (n == 0) {
+                break;
+            }
+            if constexpr (interleaved) {
+                std::copy_n(ibuf.channel(0) + pushed * m_num_channels, n * m_num_channels, region.data());
+            } else {
+                for (size_t i = 0; i < n; i++) {
+                    for (size_t c = 0; c < m_num_channels; c++) {
+                        region[i * m_num_channels + c] = ibuf.channel(c)[pushed + i];
+                    }
+                }
+            }
+            m_input.commit_write(n);
+            pushed += n;
+        }
+        if (pushed < frames) {
+            m_overruns.fetch_add(1, std::memory_order_relaxed);
+        }
+        return pushed;
+    }
+
+    /**
+     * Fill `obuf` with resampled frames. Consumer thread only. If too few frames are ready, the rest of `obuf` is filled with zeros
+     * and the shortfall is counted as an underrun. Never throws; see `failed`.
+     * @param obuf buffer to write output frames, shaped according to `OutputShape`
+     * @return The number of resampled frames written, before any zero padding.
+     */
+    template <size_t Channels, size_t Extent = std::dynamic_extent>
+    size_t pull(const SoxrBuffer<OutputType, Channels, Extent>& obuf) noexcept {
+        constexpr bool interleaved = OutputShape == SoxrDataShape::Interleaved;
+        const size_t frames = obuf.size(interleaved, m_num_channels);
+        size_t pulled = 0;
+        while (pulled < frames) {
+            auto region = m_output.read_region();
+            size_t n = std::min(frames - pulled, region.size() / m_num_channels);
+            if (n == 0) {
+                if (m_mode == StreamingMode::Consumer && pump()) {
+                    continue;
+                }
+                break;
+            }
+            if constexpr (interleaved) {
+                std::copy_n(region.data(), n * m_num_channels, obuf.channel(0) + pulled * m_num_channels);
+            } else {
+                for (size_t i = 0; i < n; i++) {
+                    for (size_t c = 0; c < m_num_channels; c++) {
+                        obuf.channel(c)[pulled + i] = region[i * m_num_channels + c];
+                    }
+                }
+            }
+            m_output.commit_read(n);
+            pulled += n;
+        }
+        if (pulled < frames) {
+            m_underruns.fetch_add(1, std::memory_order_relaxed);
+            if constexpr (interleaved) {
+                std::fill_n(obuf.channel(0) + pulled * m_num_channels, (frames - pulled) * m_num_channels, OutputType{});
+            } else {
+                for (size_t c = 0; c < m_num_channels; c++) {
+                    std::fill_n(obuf.channel(c) + pulled, frames - pulled, OutputType{});
+                }
+            }
+        }
+        return pulled;
+    }
+
+    /**
+     * Query the number of resampled frames ready to be pulled without resampling more.
+     */
+    size_t available() const noexcept {
+        return m_output.readable();
+    }
+
+    /**
+     * Query the number of `pull` calls that could not be completely filled.
+     */
+    size_t underruns() const noexcept {
+        return m_underruns.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Query the number of `push` calls that had to drop frames.
+     */
+    size_t overruns() const noexcept {
+        return m_overruns.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Query whether resampling stopped because the resampler reported an error, in either mode. Nothing more is resampled after
+     * that, so every `pull` underruns.
+     */
+    bool failed() const noexcept {
+        return m_failed.load();
+    }
+};
+
+} // namespace soxrpp
@@ -0,0 +1,230 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace soxrpp {
+
+/**
+ * Fixed-size pool of worker threads for fork-join parallelism. The thread that calls `parallel_for` takes part in the work, so a pool
+ * of size N starts N - 1 threads. Tasks are dealt out to the threads in contiguous ranges up front, and a thread that runs out of
+ * work steals half of the remaining range of another one, so uneven task costs still keep every core busy.
+ */
+class ThreadPool {
+  private:
+    // Range of task indices [begin, end) owned by one thread, packed as (begin << 32 | end) so it can be updated atomically
+    struct alignas(64) TaskRange {
+        std::atomic<uint64_t> bounds{0};
+        // Tasks the owning thread has run in the current parallel_for, stolen ones included; atomic because a worker that woke late
+        // for the previous one may still be counting when the next one resets it
+        std::atomic<size_t> runs{0};
+    };
+
+    static constexpr uint64_t pack(uint64_t begin, uint64_t end) noexcept {
+        return begin << 32 | end;
+    }
+
+    std::vector<std::thread> m_workers;
+    std::unique_ptr<TaskRange[]> m_ranges;
+    // Serializes calls to parallel_for
+    std::mutex m_run_mutex;
+
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_done;
+    std::function<void(size_t)> m_task;
+    std::atomic<size_t> m_remaining{0};
+    size_t m_generation{0};
+    // Workers inside work(), which must all have left before the next job reuses m_task and m_ranges
+    size_t m_working{0};
+    bool m_stop{false};
+    std::exception_ptr m_error;
+    std::atomic<size_t> m_steals{0};
+
+    // Takes the next task from the front of thread `self`'s own range
+    bool pop(size_t self, size_t& task) noexcept {
+        uint64_t bounds = m_ranges[self].bounds.load();
+        while (true) {
+            uint64_t begin = bounds >> 32;
+            uint64_t end = bounds & 0xffffffff;
+            if (begin >= end) {
+                return false;
+            }
+            if (m_ranges[self].bounds.compare_exchange_weak(bounds, pack(begin + 1, end))) {
+                task = begin;
+                return true;
+            }
+        }
+    }
+
+    // Moves the back half of another thread's range to thread `self`, whose own range must be empty
+    bool steal(size_t self) noexcept {
+        for (size_t offset = 1; offset < size(); offset++) {
+            TaskRange& victim = m_ranges[(self + offset) % size()];
+            uint64_t bounds = victim.bounds.load();
+            while (true) {
+                uint64_t begin = bounds >> 32;
+                uint64_t end = bounds & 0xffffffff;
+                if (begin >= end) {
+                    break;
+                }
+                uint64_t middle = begin + (end - begin) / 2;
+                if (victim.bounds.compare_exchange_weak(bounds, pack(begin, middle))) {
+                    m_ranges[self].bounds.store(pack(middle, end));
+                    m_steals++;
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    void run(size_t task) noexcept {
+        try {
+            m_task(task);
+        } catch (...) {
+            std::lock_guard lock(m_mutex);
+            if (!m_error) {
+                m_error = std::current_exception();
+            }
+        }
+        if (--m_remaining == 0) {
+            std::lock_guard lock(m_mutex);
+            m_done.notify_all();
+        }
+    }
+
+    // Runs tasks from thread `self`'s range, then from other threads' ranges, until there are none left
+    void work(size_t self) noexcept {
+        size_t task;
+        do {
+            while (pop(self, task)) {
+                m_ranges[self].runs.fetch_add(1, std::memory_order_relaxed);
+                run(task);
+            }
+        } while (steal(self));
+    }
+
+  public:
+    /**
+     * Creates a pool and starts its worker threads.
+     * @param num_threads total number of threads that run tasks, including the caller of `parallel_for`; 0 uses one per core
+     */
+    explicit ThreadPool(unsigned int num_threads = 0) {
+        if (num_threads == 0) {
+            num_threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        m_ranges = std::make_unique<TaskRange[]>(num_threads);
+        for (unsigned int t = 1; t < num_threads; t++) {
+            m_workers.emplace_back([this, t] {
+                size_t seen = 0;
+                std::unique_lock lock(m_mutex);
+                while (true) {
+                    m_wake.wait(lock, [&] {
+                        return m_stop || m_generation != seen;
+                    });
+                    if (m_stop) {
+                        return;
+                    }
+                    seen = m_generation;
+                    m_working++;
+                    lock.unlock();
+                    work(t);
+                    lock.lock();
+                    if (--m_working == 0) {
+                        m_done.notify_all();
+                    }
+                }
+            });
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    ~ThreadPool() {
+        {
+            std::lock_guard lock(m_mutex);
+            m_stop = true;
+        }
+        m_wake.notify_all();
+        for (std::thread& worker : m_workers) {
+            worker.join();
+        }
+    }
+
+    /**
+     * Query the number of threads that run tasks, including the caller of `parallel_for`.
+     */
+    size_t size() const noexcept {
+        return m_workers.size() + 1;
+    }
+
+    /**
+     * Query the number of times a thread has stolen work from another one since the pool was created.
+     */
+    size_t steals() const noexcept {
+        return m_steals.load();
+    }
+
+    /**
+     * Query the most tasks that any one thread ran in the last `parallel_for`, counting the ones it stole. Compared with the even
+     * share of `count / size()`, it shows how unevenly the work ended up spread.
+     */
+    size_t max_tasks_per_thread() const noexcept {
+        size_t most = 0;
+        for (size_t t = 0; t < size(); t++) {
+            most = std::max(most, m_ranges[t].runs.load(std::memory_order_relaxed));
+        }
+        return most;
+    }
+
+    /**
+     * Calls `fn(i)` for every `i` in [0, `count`) across the pool and waits for all of them to finish. If any call throws, the first
+     * exception is rethrown once the others are done. `count` must be less than 2^32.
+     * @param count number of tasks
+     * @param fn callable `void(*)(size_t i)` run once per task
+     */
+    template <typename Fn>
+    void parallel_for(size_t count, Fn&& fn) {
+        if (count == 0) {
+            return;
+        }
+        std::lock_guard run_lock(m_run_mutex);
+        {
+            std::lock_guard lock(m_mutex);
+            m_task = [&fn](size_t i) {
+                fn(i);
+            };
+            m_error = nullptr;
+            m_remaining = count;
+            for (size_t t = 0; t < size(); t++) {
+                m_ranges[t].bounds.store(pack(count * t / size(), count * (t + 1) / size()));
+                m_ranges[t].runs.store(0, std::memory_order_relaxed);
+            }
+            m_generation++;
+        }
+        m_wake.notify_all();
+        work(0);
+        std::unique_lock lock(m_mutex);
+        m_done.wait(lock, [this] {
+            return m_remaining == 0 && m_working == 0;
+        });
+        m_task = nullptr;
+        if (m_error) {
+            std::rethrow_exception(std::exchange(m_error, nullptr));
+        }
+    }
+};
+
+} // namespace soxrpp
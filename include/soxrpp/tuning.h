@@ -0,0 +1,356 @@
+#pragma once
+
+#include "soxrpp.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <numbers>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#include <cpuid.h>
+#endif
+
+namespace soxrpp {
+
+/**
+ * One tuned workload in a `RuntimeProfile`.
+ */
+struct RuntimeProfileEntry {
+    std::string host;     // CPU the entry was tuned on, see `RuntimeProfile::host`
+    double input_rate;    // Sample rate of the input
+    double output_rate;   // Sample rate of the output
+    unsigned int num_channels;
+    size_t block_frames;  // Input frames per `process` call
+    SoxrQualitySpec quality_spec;
+    SoxrRuntimeSpec runtime_spec;
+    double ns_per_frame;  // Measured cost of `runtime_spec`, per input frame
+};
+
+/**
+ * Tuned runtime configurations, keyed by host and workload, so one file can serve a fleet with several CPU generations. Stored as
+ * plain text with one entry per line.
+ */
+class RuntimeProfile {
+  private:
+    std::vector<RuntimeProfileEntry> m_entries;
+
+    static bool same_quality(const SoxrQualitySpec& a, const SoxrQualitySpec& b) noexcept {
+        return a.precision == b.precision && a.phase_response == b.phase_response && a.passband_end == b.passband_end &&
+               a.stopband_begin == b.stopband_begin && a.flags == b.flags;
+    }
+
+    static bool same_workload(const RuntimeProfileEntry& a, const RuntimeProfileEntry& b) noexcept {
+        return a.host == b.host && a.input_rate == b.input_rate && a.output_rate == b.output_rate &&
+               a.num_channels == b.num_channels && a.block_frames == b.block_frames && same_quality(a.quality_spec, b.quality_spec);
+    }
+
+  public:
+    /**
+     * Query the path of the profile used by `SoxrRuntimeSpec::tuned`: `$SOXRPP_RUNTIME_PROFILE` if set, otherwise
+     * `soxrpp/runtime-profile` under `$XDG_CONFIG_HOME` or `$HOME/.config`, otherwise `soxrpp-runtime-profile` in the working
+     * directory.
+     */
+    static std::string default_path() {
+        if (const char* path = std::getenv("SOXRPP_RUNTIME_PROFILE"); path != nullptr && *path != '\0') {
+            return path;
+        }
+        if (const char* config = std::getenv("XDG_CONFIG_HOME"); config != nullptr && *config != '\0') {
+            return std::string(config) + "/soxrpp/runtime-profile";
+        }
+        if (const char* home = std::getenv("HOME"); home != nullptr && *home != '\0') {
+            return std::string(home) + "/.config/soxrpp/runtime-profile";
+        }
+        return "soxrpp-runtime-profile";
+    }
+
+    /**
+     * Query the name of this host's CPU, as recorded in profile entries. Uses the CPU brand string on x86, with spaces replaced by
+     * underscores, and "generic" elsewhere.
+     */
+    static std::string host() {
+        std::string name;
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+        unsigned int brand[12] = {};
+        if (__get_cpuid_max(0x80000000, nullptr) >= 0x80000004) {
+            for (unsigned int i = 0; i < 3; i++) {
+                __get_cpuid(0x80000002 + i, &brand[4 * i], &brand[4 * i + 1], &brand[4 * i + 2], &brand[4 * i + 3]);
+            }
+            name.assign(reinterpret_cast<const char*>(brand), strnlen(reinterpret_cast<const char*>(brand), sizeof(brand)));
+        }
+#endif
+        std::string result;
+        for (char c : name) {
+            if (std::isspace((unsigned char)c)) {
+                if (!result.empty() && result.back() != '_') {
+                    result += '_';
+                }
+            } else {
+                result += c;
+            }
+        }
+        while (!result.empty() && result.back() == '_') {
+            result.pop_back();
+        }
+        return result.empty() ? "generic" : result;
+    }
+
+    /**
+     * Read a profile. A missing or unreadable file gives an empty profile, and malformed lines are skipped.
+     * @param path file to read
+     */
+    static RuntimeProfile load(const std::string& path) {
+        RuntimeProfile profile;
+        std::ifstream file(path);
+        std::string line;
+        while (std::getline(file, line)) {
+            if (line.empty() || line[0] == '#') {
+                continue;
+            }
+            std::istringstream fields(line);
+            RuntimeProfileEntry entry{};
+            SoxrQualitySpec& quality = entry.quality_spec;
+            SoxrRuntimeSpec& spec = entry.runtime_spec;
+            // Lines from before the quality spec was recorded have too few fields and fail here
+            if (fields >> entry.host >> entry.input_rate >> entry.output_rate >> entry.num_channels >> entry.block_frames >>
+                quality.precision >> quality.phase_response >> quality.passband_end >> quality.stopband_begin >> quality.flags >>
+                spec.log2_min_dft_size >> spec.log2_large_dft_size >> spec.coef_size_kbytes >> spec.num_threads >> spec.flags >>
+                entry.ns_per_frame) {
+                profile.insert(entry);
+            }
+        }
+        return profile;
+    }
+
+    /**
+     * Write the profile, replacing `path`. Throws a `SoxrError` if the file can't be written.
+     * @param path file to write
+     */
+    void save(const std::string& path) const {
+        std::ofstream file(path, std::ios::trunc);
+        file << "# host input_rate output_rate num_channels block_frames precision phase_response passband_end stopband_begin "
+                "quality_flags log2_min_dft_size log2_large_dft_size coef_size_kbytes num_threads flags ns_per_frame\n";
+        file.precision(17);
+        for (const RuntimeProfileEntry& entry : m_entries) {
+            const SoxrQualitySpec& quality = entry.quality_spec;
+            const SoxrRuntimeSpec& spec = entry.runtime_spec;
+            file << entry.host << ' ' << entry.input_rate << ' ' << entry.output_rate << ' ' << entry.num_channels << ' '
+                 << entry.block_frames << ' ' << quality.precision << ' ' << quality.phase_response << ' ' << quality.passband_end
+                 << ' ' << quality.stopband_begin << ' ' << quality.flags << ' ' << spec.log2_min_dft_size << ' '
+                 << spec.log2_large_dft_size << ' ' << spec.coef_size_kbytes << ' ' << spec.num_threads << ' ' << spec.flags << ' '
+                 << entry.ns_per_frame << '\n';
+        }
+        if (!file) {
+            throw SoxrError("Couldn't write runtime profile");
+        }
+    }
+
+    /**
+     * Add an entry, replacing any earlier one for the same host and workload.
+     */
+    void insert(const RuntimeProfileEntry& entry) {
+        auto it = std::find_if(m_entries.begin(), m_entries.end(), [&](const RuntimeProfileEntry& other) {
+            return same_workload(entry, other);
+        });
+        if (it != m_entries.end()) {
+            *it = entry;
+        } else {
+            m_entries.push_back(entry);
+        }
+    }
+
+    /**
+     * Find the entry for `host`, the given rates and quality spec whose channel count and block size are closest, by ratio, to the
+     * given ones. Entries tuned for another quality spec are never used, since its filter lengths favour other DFT sizes.
+     * @return The entry, or nullptr if there is none for this host, these rates and this quality spec.
+     */
+    const RuntimeProfileEntry* find(const std::string& host,
+                                    double input_rate,
+                                    double output_rate,
+                                    unsigned int num_channels,
+                                    size_t block_frames,
+                                    const SoxrQualitySpec& quality_spec) const {
+        const RuntimeProfileEntry* best = nullptr;
+        double best_distance = 0;
+        for (const RuntimeProfileEntry& entry : m_entries) {
+            if (entry.host != host || entry.input_rate != input_rate || entry.output_rate != output_rate ||
+                !same_quality(entry.quality_spec, quality_spec)) {
+                continue;
+            }
+            const double blocks = (double)std::max<size_t>(1, entry.block_frames) / std::max<size_t>(1, block_frames);
+            const double channels = (double)std::max(1u, entry.num_channels) / std::max(1u, num_channels);
+            const double distance = std::abs(std::log2(blocks)) + std::abs(std::log2(channels));
+            if (best == nullptr || distance < best_distance) {
+                best = &entry;
+                best_distance = distance;
+            }
+        }
+        return best;
+    }
+
+    const std::vector<RuntimeProfileEntry>& entries() const noexcept {
+        return m_entries;
+    }
+};
+
+inline SoxrRuntimeSpec SoxrRuntimeSpec::tuned(double input_rate,
+                                              double output_rate,
+                                              unsigned int num_channels,
+                                              size_t block_frames,
+                                              const SoxrQualitySpec& quality_spec) {
+    static const RuntimeProfile profile = RuntimeProfile::load(RuntimeProfile::default_path());
+    static const std::string host = RuntimeProfile::host();
+    const RuntimeProfileEntry* entry = profile.find(host, input_rate, output_rate, num_channels, block_frames, quality_spec);
+    return entry != nullptr ? entry->runtime_spec : SoxrRuntimeSpec(1);
+}
+
+/**
+ * Values swept by `tune_runtime_spec`. The defaults cover soxr's useful range for each parameter.
+ */
+struct RuntimeTuningOptions {
+    double min_time_ms = 20; // Time spent measuring each candidate
+    std::vector<unsigned int> log2_min_dft_sizes = {8, 9, 10, 11, 12};
+    std::vector<unsigned int> log2_large_dft_sizes = {14, 15, 16, 17, 18};
+    std::vector<unsigned int> coef_sizes_kbytes = {100, 400, 1600};
+    // Defaults to 1 and, on multi-core hosts, the number of hardware threads
+    std::vector<unsigned int> thread_counts = {};
+    std::vector<unsigned long> coef_interp_flags = {
+        SoxrRuntimeFlags::CoeffInterpAuto, SoxrRuntimeFlags::CoeffInterpLow, SoxrRuntimeFlags::CoeffInterpHigh};
+    // Full passes over the parameters; the search stops early once a pass changes nothing
+    unsigned int max_passes = 3;
+};
+
+namespace detail {
+
+// Mean cost of `process` per input frame, after a warm-up call that absorbs soxr's lazy setup
+inline double measure_runtime_spec(double input_rate,
+                                   double output_rate,
+                                   unsigned int num_channels,
+                                   size_t block_frames,
+                                   const SoxrQualitySpec& quality_spec,
+                                   const SoxrRuntimeSpec& runtime_spec,
+                                   double min_time_ms) {
+    using IoSpec = SoxrIoSpec<const float, SoxrDataShape::Interleaved, float, SoxrDataShape::Interleaved>;
+    SoxResampler<const float, float> resampler(input_rate, output_rate, num_channels, IoSpec(), quality_spec, runtime_spec);
+    std::vector<float> input(block_frames * num_channels);
+    for (size_t i = 0; i < input.size(); i++) {
+        input[i] = (float)(0.5 * std::sin(2 * std::numbers::pi * 1000 * (i / num_channels) / input_rate));
+    }
+    std::vector<float> output((output_frames(block_frames, input_rate, output_rate) + 16) * num_channels);
+    SoxrBuffer<const float> ibuf(input.data(), input.size());
+    SoxrBuffer<float> obuf(output.data(), output.size());
+    resampler.process(ibuf, obuf);
+
+    using Clock = std::chrono::steady_clock;
+    const auto budget = std::chrono::duration<double, std::milli>(min_time_ms);
+    const auto start = Clock::now();
+    size_t frames = 0;
+    auto now = start;
+    do {
+        frames += resampler.process(ibuf, obuf).first;
+        now = Clock::now();
+    } while (now - start < budget);
+    return std::chrono::duration<double, std::nano>(now - start).count() / std::max<size_t>(1, frames);
+}
+
+} // namespace detail
+
+/**
+ * Find the fastest `SoxrRuntimeSpec` on this host for a workload by timing `process` calls of float samples. Parameters are tuned
+ * one at a time, each swept over its values in `options` with the others held at their best so far, for a few passes; this visits
+ * far fewer candidates than the full grid, and the parameters barely interact. Combinations that soxr rejects are skipped.
+ * @param input_rate sample rate of the input
+ * @param output_rate target sample rate of the resampled output
+ * @param num_channels channel count
+ * @param block_frames number of input frames per `process` call
+ * @param quality_spec resampling quality configuration the workload uses
+ * @param options values to try
+ * @return An entry for this host, ready to be inserted into a `RuntimeProfile`.
+ */
+inline RuntimeProfileEntry tune_runtime_spec(double input_rate,
+                                             double output_rate,
+                                             unsigned int num_channels,
+                                             size_t block_frames,
+                                             const SoxrQualitySpec& quality_spec = SoxrQualitySpec(SoxrQualityRecipe::High, 0),
+                                             RuntimeTuningOptions options = RuntimeTuningOptions()) {
+    if (options.thread_counts.empty()) {
+        options.thread_counts.push_back(1);
+        if (unsigned int threads = std::thread::hardware_concurrency(); threads > 1) {
+            options.thread_counts.push_back(threads);
+        }
+    }
+
+    SoxrRuntimeSpec best(1);
+    double best_cost = detail::measure_runtime_spec(
+        input_rate, output_rate, num_channels, block_frames, quality_spec, best, options.min_time_ms);
+    // Tries every value of one parameter, keeping whichever is fastest
+    auto sweep = [&](const auto& values, auto&& apply) {
+        bool changed = false;
+        for (const auto& value : values) {
+            SoxrRuntimeSpec candidate = best;
+            apply(candidate, value);
+            if (candidate.log2_min_dft_size > candidate.log2_large_dft_size) {
+                continue;
+            }
+            try {
+                double cost = detail::measure_runtime_spec(
+                    input_rate, output_rate, num_channels, block_frames, quality_spec, candidate, options.min_time_ms);
+                if (cost < best_cost) {
+                    best = candidate;
+                    best_cost = cost;
+                    changed = true;
+                }
+            } catch (const SoxrError&) {
+            }
+        }
+        return changed;
+    };
+
+    constexpr unsigned long coef_interp_mask =
+        SoxrRuntimeFlags::CoeffInterpAuto | SoxrRuntimeFlags::CoeffInterpLow | SoxrRuntimeFlags::CoeffInterpHigh;
+    for (unsigned int pass = 0; pass < options.max_passes; pass++) {
+        bool changed = false;
+        changed |= sweep(options.log2_min_dft_sizes, [](SoxrRuntimeSpec& spec, unsigned int value) {
+            spec.log2_min_dft_size = value;
+        });
+        changed |= sweep(options.log2_large_dft_sizes, [](SoxrRuntimeSpec& spec, unsigned int value) {
+            spec.log2_large_dft_size = value;
+        });
+        changed |= sweep(options.coef_interp_flags, [](SoxrRuntimeSpec& spec, unsigned long value) {
+            spec.flags = (spec.flags & ~coef_interp_mask) | value;
+        });
+        // The coefficient table size only steers the automatic choice of interpolation
+        if ((best.flags & coef_interp_mask) == SoxrRuntimeFlags::CoeffInterpAuto) {
+            changed |= sweep(options.coef_sizes_kbytes, [](SoxrRuntimeSpec& spec, unsigned int value) {
+                spec.coef_size_kbytes = value;
+            });
+        }
+        changed |= sweep(options.thread_counts, [](SoxrRuntimeSpec& spec, unsigned int value) {
+            spec.num_threads = value;
+        });
+        if (!changed) {
+            break;
+        }
+    }
+
+    return RuntimeProfileEntry{
+        .host = RuntimeProfile::host(),
+        .input_rate = input_rate,
+        .output_rate = output_rate,
+        .num_channels = num_channels,
+        .block_frames = block_frames,
+        .quality_spec = quality_spec,
+        .runtime_spec = best,
+        .ns_per_frame = best_cost,
+    };
+}
+
+} // namespace soxrpp
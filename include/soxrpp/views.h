@@ -0,0 +1,351 @@
+#pragma once
+
+#include "soxrpp.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace soxrpp {
+
+/**
+ * View of `Channels` channels that each step through memory with the same stride, such as a few channels picked out of a wide
+ * interleaved capture (stride = the capture's channel count) or out of split buffers (stride = 1). Doesn't own or copy any samples.
+ */
+template <typename Type, size_t Channels>
+class StridedBuffer {
+  private:
+    std::array<Type*, Channels> m_channels;
+    size_t m_stride;
+    size_t m_frames;
+
+  public:
+    static constexpr size_t channels = Channels;
+
+    /**
+     * Creates a view from the address of the first sample of each channel.
+     * @param channels pointer to the first sample of each channel in the view
+     * @param stride distance between consecutive samples of a channel, in samples
+     * @param frames number of samples per channel
+     */
+    StridedBuffer(std::array<Type*, Channels> channels, size_t stride, size_t frames) noexcept
+        : m_channels(channels)
+        , m_stride(stride)
+        , m_frames(frames) {}
+
+    /**
+     * Query the pointer to the first sample of channel `i` of the view.
+     */
+    Type* channel(size_t i) const noexcept {
+        return m_channels[i];
+    }
+
+    /**
+     * Query the distance between consecutive samples of a channel, in samples.
+     */
+    size_t stride() const noexcept {
+        return m_stride;
+    }
+
+    /**
+     * Query the number of samples per channel.
+     */
+    size_t frames() const noexcept {
+        return m_frames;
+    }
+
+    /**
+     * Returns a view of the same channels that starts `frames` samples later.
+     * @param frames number of samples per channel to skip, clamped to the size of the view
+     */
+    StridedBuffer advance(size_t frames) const noexcept {
+        frames = std::min(frames, m_frames);
+        std::array<Type*, Channels> ptrs;
+        for (size_t c = 0; c < Channels; c++) {
+            ptrs[c] = m_channels[c] + frames * m_stride;
+        }
+        return StridedBuffer(ptrs, m_stride, m_frames - frames);
+    }
+};
+
+/**
+ * Selects channels of an interleaved buffer, in the given order.
+ * @param buffer interleaved buffer
+ * @param num_channels channel count of `buffer`
+ * @param selection index of each channel to select
+ */
+template <size_t Selected, typename Type, size_t Extent>
+StridedBuffer<Type, Selected> select_channels(const SoxrBuffer<Type, 1, Extent>& buffer,
+                                              unsigned int num_channels,
+                                              const std::array<size_t, Selected>& selection) {
+    std::array<Type*, Selected> ptrs;
+    for (size_t c = 0; c < Selected; c++) {
+        if (selection[c] >= num_channels) {
+            throw SoxrError("Selected channel is out of range");
+        }
+        ptrs[c] = buffer.channel(0) + selection[c];
+    }
+    return StridedBuffer<Type, Selected>(ptrs, num_channels, buffer.size(true, num_channels));
+}
+
+/**
+ * Selects channels of a split buffer, in the given order.
+ * @param buffer split buffer
+ * @param selection index of each channel to select
+ */
+template <size_t Selected, typename Type, size_t Channels, size_t Extent>
+StridedBuffer<Type, Selected> select_channels(const SoxrBuffer<Type, Channels, Extent>& buffer,
+                                              const std::array<size_t, Selected>& selection) {
+    std::array<Type*, Selected> ptrs;
+    for (size_t c = 0; c < Selected; c++) {
+        if (selection[c] >= Channels) {
+            throw SoxrError("Selected channel is out of range");
+        }
+        ptrs[c] = buffer.channel(selection[c]);
+    }
+    return StridedBuffer<Type, Selected>(ptrs, 1, buffer.size(false, Selected));
+}
+
+namespace detail {
+
+// Copies `frames` samples of channel pair (`a`, `a + 1`) at stride `stride` into `dst_a` and `dst_b`, four frames at a time
+template <typename Type>
+size_t deinterleave_pair(const Type* a, size_t stride, Type* dst_a, Type* dst_b, size_t frames) noexcept {
+    size_t f = 0;
+#if defined(__SSE2__)
+    if constexpr (sizeof(Type) == 4) {
+        for (; f + 4 <= frames; f += 4) {
+            const Type* p = a + f * stride;
+            // [a0 b0 a1 b1] and [a2 b2 a3 b3], then separate the a's from the b's
+            __m128i x01 = _mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i*)p), _mm_loadl_epi64((const __m128i*)(p + stride)));
+            __m128i x23 = _mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i*)(p + 2 * stride)),
+                                             _mm_loadl_epi64((const __m128i*)(p + 3 * stride)));
+            x01 = _mm_shuffle_epi32(x01, _MM_SHUFFLE(3, 1, 2, 0));
+            x23 = _mm_shuffle_epi32(x23, _MM_SHUFFLE(3, 1, 2, 0));
+            _mm_storeu_si128((__m128i*)(dst_a + f), _mm_unpacklo_epi64(x01, x23));
+            _mm_storeu_si128((__m128i*)(dst_b + f), _mm_unpackhi_epi64(x01, x23));
+        }
+    }
+#endif
+    return f;
+}
+
+// Inverse of deinterleave_pair
+template <typename Type>
+size_t interleave_pair(const Type* src_a, const Type* src_b, Type* a, size_t stride, size_t frames) noexcept {
+    size_t f = 0;
+#if defined(__SSE2__)
+    if constexpr (sizeof(Type) == 4) {
+        for (; f + 4 <= frames; f += 4) {
+            __m128i va = _mm_loadu_si128((const __m128i*)(src_a + f));
+            __m128i vb = _mm_loadu_si128((const __m128i*)(src_b + f));
+            __m128i lo = _mm_unpacklo_epi32(va, vb);
+            __m128i hi = _mm_unpackhi_epi32(va, vb);
+            Type* p = a + f * stride;
+            _mm_storel_epi64((__m128i*)p, lo);
+            _mm_storel_epi64((__m128i*)(p + stride), _mm_srli_si128(lo, 8));
+            _mm_storel_epi64((__m128i*)(p + 2 * stride), hi);
+            _mm_storel_epi64((__m128i*)(p + 3 * stride), _mm_srli_si128(hi, 8));
+        }
+    }
+#endif
+    return f;
+}
+
+// Copies `frames` frames of `src`, starting at frame `from`, into split channels `dst`
+template <typename Type, typename Raw, size_t Channels>
+void gather(const StridedBuffer<Type, Channels>& src, size_t from, size_t frames, Raw* const* dst, size_t num_channels) noexcept {
+    const size_t stride = src.stride();
+    for (size_t c = 0; c < num_channels; c++) {
+        const Type* a = src.channel(c) + from * stride;
+        if (stride == 1) {
+            std::copy_n(a, frames, dst[c]);
+            continue;
+        }
+        size_t f = 0;
+        // Adjacent channels are read in pairs, so each load brings in samples of both
+        if (c + 1 < num_channels && src.channel(c + 1) == src.channel(c) + 1) {
+            f = deinterleave_pair(a, stride, dst[c], dst[c + 1], frames);
+            for (size_t g = f; g < frames; g++) {
+                dst[c + 1][g] = a[g * stride + 1];
+            }
+            for (; f < frames; f++) {
+                dst[c][f] = a[f * stride];
+            }
+            c++;
+            continue;
+        }
+        for (; f < frames; f++) {
+            dst[c][f] = a[f * stride];
+        }
+    }
+}
+
+// Copies `frames` frames from split channels `src` into `dst`, starting at frame `to`
+template <typename Type, size_t Channels>
+void scatter(
+    const Type* const* src, const StridedBuffer<Type, Channels>& dst, size_t to, size_t frames, size_t num_channels) noexcept {
+    const size_t stride = dst.stride();
+    for (size_t c = 0; c < num_channels; c++) {
+        Type* a = dst.channel(c) + to * stride;
+        if (stride == 1) {
+            std::copy_n(src[c], frames, a);
+            continue;
+        }
+        size_t f = 0;
+        if (c + 1 < num_channels && dst.channel(c + 1) == dst.channel(c) + 1) {
+            f = interleave_pair(src[c], src[c + 1], a, stride, frames);
+            for (; f < frames; f++) {
+                a[f * stride] = src[c][f];
+                a[f * stride + 1] = src[c + 1][f];
+            }
+            c++;
+            continue;
+        }
+        for (; f < frames; f++) {
+            a[f * stride] = src[c][f];
+        }
+    }
+}
+
+} // namespace detail
+
+/**
+ * Stream resampler for `StridedBuffer` views. Only the channels in the view are copied, one block at a time, into split buffers for
+ * soxr, and the output is copied back the same way, so picking a few channels out of a wide capture costs neither a copy of the
+ * whole capture nor resampling the channels that weren't picked. The blocks are allocated once.
+ */
+template <typename InputType = float, typename OutputType = float>
+class StridedResampler {
+  private:
+    using RawInputType = std::remove_const_t<InputType>;
+
+  public:
+    using Resampler = SoxResampler<const RawInputType, OutputType, SoxrDataShape::Split, SoxrDataShape::Split>;
+    using IoSpec = SoxrIoSpec<const RawInputType, SoxrDataShape::Split, OutputType, SoxrDataShape::Split>;
+
+  private:
+    Resampler m_resampler;
+    size_t m_block_frames;
+    std::vector<RawInputType> m_input_block;
+    std::vector<OutputType> m_output_block;
+    std::vector<RawInputType*> m_input_channels;
+    std::vector<OutputType*> m_output_channels;
+
+    template <typename Type, size_t Channels>
+    SoxrBuffer<Type, Channels> block_buffer(Type* const* channels, size_t frames) const {
+        std::array<Type*, Channels> ptrs{};
+        std::copy_n(channels, std::min<size_t>(m_resampler.num_channels(), Channels), ptrs.begin());
+        return SoxrBuffer<Type, Channels>(ptrs, frames);
+    }
+
+  public:
+    /**
+     * Creates a stream resampler for strided data.
+     * @param input_rate sample rate of the input
+     * @param output_rate target sample rate of the resampled output
+     * @param num_channels channel count, at most the number of channels in the views passed to `process`
+     * @param block_frames number of frames copied at a time
+     * @param io_spec input/output configuration
+     * @param quality_spec resampling quality configuration
+     * @param runtime_spec runtime configuration
+     */
+    StridedResampler(double input_rate,
+                     double output_rate,
+                     unsigned int num_channels,
+                     size_t block_frames = 1024,
+                     const IoSpec& io_spec = IoSpec(),
+                     const SoxrQualitySpec& quality_spec = SoxrQualitySpec(SoxrQualityRecipe::High, 0),
+                     const SoxrRuntimeSpec& runtime_spec = SoxrRuntimeSpec(1))
+        : m_resampler(input_rate, output_rate, num_channels, io_spec, quality_spec, runtime_spec)
+        , m_block_frames(block_frames)
+        , m_input_block(block_frames * num_channels)
+        , m_output_block(block_frames * num_channels) //
+    {
+        for (size_t c = 0; c < num_channels; c++) {
+            m_input_channels.push_back(m_input_block.data() + c * block_frames);
+            m_output_channels.push_back(m_output_block.data() + c * block_frames);
+        }
+    }
+
+    /**
+     * Resamples data from the provided input view into the provided output view. Same contract as `SoxResampler::process`.
+     * @param ibuf readonly view of input samples
+     * @param obuf view to write output samples
+     * @param done true if there are no input samples and no more will be available
+     * @return The pair (`ilen`, `olen`) describing the number of samples read and written respectively.
+     */
+    template <size_t InputChannels, size_t OutputChannels>
+    std::pair<size_t, size_t> process(const StridedBuffer<InputType, InputChannels>& ibuf,
+                                      const StridedBuffer<OutputType, OutputChannels>& obuf,
+                                      bool done = false) {
+        const unsigned int num_channels = m_resampler.num_channels();
+        if (num_channels > InputChannels || num_channels > OutputChannels) {
+            throw SoxrError("Views have fewer channels than the resampler");
+        }
+        const size_t ilen = done ? 0 : ibuf.frames();
+        const size_t olen = obuf.frames();
+
+        size_t idone = 0, odone = 0;
+        while (odone < olen && (done || idone < ilen)) {
+            size_t in_frames = std::min(m_block_frames, ilen - idone);
+            size_t out_frames = std::min(m_block_frames, olen - odone);
+            detail::gather(ibuf, idone, in_frames, m_input_channels.data(), num_channels);
+            auto block_ibuf = block_buffer<const RawInputType, InputChannels>(m_input_channels.data(), in_frames);
+            auto block_obuf = block_buffer<OutputType, OutputChannels>(m_output_channels.data(), out_frames);
+            auto [i, o] = m_resampler.process(block_ibuf, block_obuf, done);
+            detail::scatter(m_output_channels.data(), obuf, odone, o, num_channels);
+            idone += i;
+            odone += o;
+            if (i == 0 && o == 0) {
+                break;
+            }
+        }
+
+        return std::make_pair(idone, odone);
+    }
+
+    /**
+     * Access the underlying resampler, for example to query its delay or clear it.
+     */
+    Resampler& resampler() noexcept {
+        return m_resampler;
+    }
+};
+
+/**
+ * Resample a (probably short) signal held entirely in memory, reading and writing through strided views. Resamples as many channels
+ * as the views have. Note that the default quality is lower than for `process`.
+ * @param input_rate sample rate of the input
+ * @param output_rate target sample rate of the resampled output
+ * @param ibuf view of input samples
+ * @param obuf view to write output samples
+ * @param io_spec input/output configuration
+ * @param quality_spec resampling quality configuration
+ * @param runtime_spec runtime configuration
+ * @return The pair (`ilen`, `olen`) describing the number of samples read and written respectively.
+ */
+template <typename InputType, typename OutputType, size_t Channels>
+std::pair<size_t, size_t> oneshot(double input_rate,
+                                  double output_rate,
+                                  const StridedBuffer<InputType, Channels>& ibuf,
+                                  const StridedBuffer<OutputType, Channels>& obuf,
+                                  const typename StridedResampler<InputType, OutputType>::IoSpec& io_spec =
+                                      typename StridedResampler<InputType, OutputType>::IoSpec(),
+                                  const SoxrQualitySpec& quality_spec = SoxrQualitySpec(SoxrQualityRecipe::Low, 0),
+                                  const SoxrRuntimeSpec& runtime_spec = SoxrRuntimeSpec(1)) {
+    StridedResampler<InputType, OutputType> resampler(
+        input_rate, output_rate, Channels, std::clamp<size_t>(ibuf.frames(), 1, 1 << 14), io_spec, quality_spec, runtime_spec);
+    auto [idone, odone] = resampler.process(ibuf, obuf);
+    auto [_, flushed] = resampler.process(ibuf, obuf.advance(odone), true);
+    return std::make_pair(idone, odone + flushed);
+}
+
+} // namespace soxrpp